@@ -0,0 +1,216 @@
+#ifndef BOARD_ENUM_HPP
+#define BOARD_ENUM_HPP
+
+#include <vector>
+
+#include "types.hpp"
+#include "util.hpp"
+
+namespace Poker {
+  namespace BoardEnum {
+
+    // Flop, turn and river
+    const int N_BOARD_CARDS = 5;
+
+    // Visit every board not using any of the dead cards, each with weight 1.
+    // Callback is callback(const U8CardT board[N_BOARD_CARDS], u64 weight)
+    template <typename CallbackT>
+    void for_each_board(const U8CardT* dead_cards, int n_dead_cards, CallbackT callback) {
+      bool is_dead[52] = {};
+      for (int i = 0; i < n_dead_cards; i++) {
+	is_dead[dead_cards[i].u8_card] = true;
+      }
+
+      U8CardT live_cards[52];
+      int n_live_cards = 0;
+      for (u8 card = 0; card < 52; card++) {
+	if (!is_dead[card]) {
+	  live_cards[n_live_cards++] = U8CardT(card);
+	}
+      }
+
+      U8CardT board[N_BOARD_CARDS];
+      for (int i0 = 0; i0 < n_live_cards; i0++) {
+	board[0] = live_cards[i0];
+	for (int i1 = i0+1; i1 < n_live_cards; i1++) {
+	  board[1] = live_cards[i1];
+	  for (int i2 = i1+1; i2 < n_live_cards; i2++) {
+	    board[2] = live_cards[i2];
+	    for (int i3 = i2+1; i3 < n_live_cards; i3++) {
+	      board[3] = live_cards[i3];
+	      for (int i4 = i3+1; i4 < n_live_cards; i4++) {
+		board[4] = live_cards[i4];
+		callback((const U8CardT*)board, (u64)1);
+	      }
+	    }
+	  }
+	}
+      }
+    }
+
+    // Enumeration of suit-isomorphic boards relative to a set of players' hole cards.
+    // Two suits are interchangeable iff every player holds the same ranks in both suits.
+    // Permuting interchangeable suits of a board leaves every player's showdown unchanged, so we
+    //   only visit one board of each such class, weighted by the class size.
+    struct CanonicalBoardEnumT {
+      // Suits in visiting order - interchangeable suits are adjacent
+      SuitT suit_order[NSuits];
+      // Whether suit_order[i] is interchangeable with suit_order[i-1]
+      bool same_as_prev[NSuits];
+      // Aces-high ranks (bit 0 is Two) held by any player in each suit
+      u16 dead_ranks[NSuits];
+
+      // Per-suit board ranks of the board being built, in suit_order order
+      u16 board_ranks[NSuits];
+
+      // All 13-bit rank sets by size, for sizes up to N_BOARD_CARDS, each in ascending order
+      static const std::vector<u16>* make_rank_sets_by_size() {
+	std::vector<u16>* rank_sets = new std::vector<u16>[N_BOARD_CARDS+1];
+	for (u16 ranks = 0; ranks < (1 << 13); ranks++) {
+	  int n_ranks = Util::bitcount(ranks);
+	  if (n_ranks <= N_BOARD_CARDS) {
+	    rank_sets[n_ranks].push_back(ranks);
+	  }
+	}
+	return rank_sets;
+      }
+
+      static const std::vector<u16>* rank_sets_by_size() {
+	static const std::vector<u16>* rank_sets = make_rank_sets_by_size();
+	return rank_sets;
+      }
+
+      static inline u16 rank_bit(U8CardT card) {
+	return (u16)(1 << (to_ace_hi(card.rank()) - Two));
+      }
+
+      static inline U8CardT to_card(SuitT suit, int rank_bit_no) {
+	return U8CardT((u8)((to_ace_low((RankT)(rank_bit_no + Two)) << 2) + suit));
+      }
+
+      // @param hole_cards - two cards per player
+      CanonicalBoardEnumT(const U8CardT* hole_cards, int n_players): same_as_prev(), dead_ranks(), board_ranks() {
+	// Per-suit, per-player ranks
+	std::vector<u16> player_ranks[NSuits];
+	for (int suit = 0; suit < NSuits; suit++) {
+	  player_ranks[suit].resize(n_players);
+	}
+	for (int player_no = 0; player_no < n_players; player_no++) {
+	  for (int i = 0; i < 2; i++) {
+	    U8CardT card = hole_cards[2*player_no + i];
+	    player_ranks[card.suit()][player_no] |= rank_bit(card);
+	    dead_ranks[card.suit()] |= rank_bit(card);
+	  }
+	}
+
+	// Group interchangeable suits
+	bool placed[NSuits] = {};
+	int n_placed = 0;
+	for (int suit = 0; suit < NSuits; suit++) {
+	  if (placed[suit]) {
+	    continue;
+	  }
+	  for (int other = suit; other < NSuits; other++) {
+	    if (!placed[other] && player_ranks[other] == player_ranks[suit]) {
+	      same_as_prev[n_placed] = (other != suit);
+	      suit_order[n_placed++] = (SuitT)other;
+	      placed[other] = true;
+	    }
+	  }
+	}
+      }
+
+      template <typename CallbackT>
+      void for_each(CallbackT callback) {
+	visit(0, N_BOARD_CARDS, callback);
+      }
+
+      template <typename CallbackT>
+      void visit(int i, int n_cards_left, CallbackT& callback) {
+	if (i == NSuits) {
+	  if (n_cards_left == 0) {
+	    emit(callback);
+	  }
+	  return;
+	}
+
+	const SuitT suit = suit_order[i];
+	const std::vector<u16>* rank_sets = rank_sets_by_size();
+
+	// The last suit takes all remaining cards
+	const int min_n_ranks = (i == NSuits-1) ? n_cards_left : 0;
+
+	// Within a group of interchangeable suits, only visit non-increasing (size, ranks)
+	const bool is_bounded = i > 0 && same_as_prev[i];
+	const u16 prev_ranks = i > 0 ? board_ranks[i-1] : 0;
+	const int prev_n_ranks = Util::bitcount(prev_ranks);
+
+	for (int n_ranks = min_n_ranks; n_ranks <= n_cards_left; n_ranks++) {
+	  if (is_bounded && n_ranks > prev_n_ranks) {
+	    break;
+	  }
+	  for (u16 ranks : rank_sets[n_ranks]) {
+	    if (ranks & dead_ranks[suit]) {
+	      continue;
+	    }
+	    if (is_bounded && n_ranks == prev_n_ranks && ranks > prev_ranks) {
+	      break;
+	    }
+	    board_ranks[i] = ranks;
+	    visit(i+1, n_cards_left - n_ranks, callback);
+	  }
+	}
+      }
+
+      template <typename CallbackT>
+      void emit(CallbackT& callback) {
+	// Class size is the number of distinct rearrangements within each group - k!/(m1!.m2!...)
+	//   for a group of k suits with runs of m1, m2, ... equal rank sets.
+	static const u64 FACTORIAL[NSuits+1] = { 1, 1, 2, 6, 24 };
+	// Numerator and denominator are accumulated separately since the partial quotients aren't integral.
+	u64 weight_num = 1;
+	u64 weight_den = 1;
+	int group_size = 0;
+	int run_len = 0;
+	for (int i = 0; i < NSuits; i++) {
+	  if (!same_as_prev[i]) {
+	    weight_num *= FACTORIAL[group_size];
+	    group_size = 0;
+	  }
+	  if (i == 0 || !same_as_prev[i] || board_ranks[i] != board_ranks[i-1]) {
+	    weight_den *= FACTORIAL[run_len];
+	    run_len = 0;
+	  }
+	  group_size++;
+	  run_len++;
+	}
+	weight_num *= FACTORIAL[group_size];
+	weight_den *= FACTORIAL[run_len];
+	const u64 weight = weight_num / weight_den;
+
+	U8CardT board[N_BOARD_CARDS];
+	int n_cards = 0;
+	for (int i = 0; i < NSuits; i++) {
+	  for (u16 ranks = board_ranks[i]; ranks != 0; ranks &= ranks - 1) {
+	    board[n_cards++] = to_card(suit_order[i], __builtin_ctz(ranks));
+	  }
+	}
+
+	callback((const U8CardT*)board, weight);
+      }
+    }; // struct CanonicalBoardEnumT
+
+    // Visit one board of each suit-isomorphism class relative to the players' hole cards, weighted
+    //   by the class size. Weights sum to the number of boards not using the hole cards.
+    // Callback is callback(const U8CardT board[N_BOARD_CARDS], u64 weight)
+    // @param hole_cards - two cards per player
+    template <typename CallbackT>
+    void for_each_canonical_board(const U8CardT* hole_cards, int n_players, CallbackT callback) {
+      CanonicalBoardEnumT board_enum(hole_cards, n_players);
+      board_enum.for_each(callback);
+    }
+
+  } // namespace BoardEnum
+} // namespace Poker
+
+#endif //ndef BOARD_ENUM_HPP
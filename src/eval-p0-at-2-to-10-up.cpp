@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <map>
 #include <utility>
 
 #include <cstdio>
+#include <cstring>
 
+#include "board-enum.hpp"
 #include "dealer.hpp"
 #include "hand-eval.hpp"
 #include "normal.hpp"
@@ -123,7 +126,98 @@ static void eval_p0_up_to_n_up(int n_players) {
   }
 }
 
-int main() {
+// Exact multiway equity of fixed hole cards, over suit-isomorphic boards with weights (or over every board).
+// Player 0's profit is as in eval_p0_up_to_n_up() - its share of the losers' bets if it has the best hand, else -1.0.
+static void eval_exact(int n_players, char* hole_strs[], bool canonical_boards) {
+  if(n_players < 2 || 10 < n_players) {
+    fprintf(stderr, "n_players must be 2-10 but got %d\n", n_players);
+    exit(1);
+  }
+
+  Poker::U8CardT holes[2*10];
+  for(int player_no = 0; player_no < n_players; player_no++) {
+    const char* hole_str = hole_strs[player_no];
+    if(std::strlen(hole_str) != 4 || !Poker::parse_u8card(hole_str, holes[2*player_no]) || !Poker::parse_u8card(hole_str+2, holes[2*player_no + 1])) {
+      fprintf(stderr, "bad hole cards %s - expecting e.g. AhKd\n", hole_str);
+      exit(1);
+    }
+  }
+  for(int i = 0; i < 2*n_players; i++) {
+    for(int j = i+1; j < 2*n_players; j++) {
+      if(holes[i].u8_card == holes[j].u8_card) {
+	fprintf(stderr, "duplicate hole cards\n");
+	exit(1);
+      }
+    }
+  }
+
+  Poker::HandT hole_hands[10];
+  for(int player_no = 0; player_no < n_players; player_no++) {
+    hole_hands[player_no] = Poker::HandT(Poker::HandT(holes[2*player_no]), Poker::HandT(holes[2*player_no + 1]));
+  }
+
+  u64 n_boards_visited = 0;
+  u64 n_boards = 0;
+  // Pot share of each player, weighted by board count
+  double equities[10] = {};
+  double p0_profit = 0.0;
+
+  auto eval_board = [&](const Poker::U8CardT* board, u64 weight) {
+    Poker::HandT board_hand;
+    for(int i = 0; i < Poker::BoardEnum::N_BOARD_CARDS; i++) {
+      board_hand.add(board[i]);
+    }
+
+    Poker::HandEval::HandEvalCompactT hand_evals[10];
+    Poker::HandEval::HandEvalCompactT best_hand_eval = 0;
+    for(int player_no = 0; player_no < n_players; player_no++) {
+      hand_evals[player_no] = Poker::HandEval::eval_hand_5_to_9_card_compact_fast1(Poker::HandT(board_hand, hole_hands[player_no]));
+      best_hand_eval = std::max(best_hand_eval, hand_evals[player_no]);
+    }
+
+    int n_best_hands = 0;
+    for(int player_no = 0; player_no < n_players; player_no++) {
+      n_best_hands += (hand_evals[player_no] == best_hand_eval);
+    }
+
+    for(int player_no = 0; player_no < n_players; player_no++) {
+      if(hand_evals[player_no] == best_hand_eval) {
+	equities[player_no] += (double)weight/(double)n_best_hands;
+      }
+    }
+
+    if(hand_evals[0] == best_hand_eval) {
+      p0_profit += (double)weight * (double)(n_players - n_best_hands)/(double)n_best_hands;
+    } else {
+      p0_profit -= (double)weight;
+    }
+
+    n_boards_visited++;
+    n_boards += weight;
+  };
+
+  if(canonical_boards) {
+    Poker::BoardEnum::for_each_canonical_board(holes, n_players, eval_board);
+  } else {
+    Poker::BoardEnum::for_each_board(holes, 2*n_players, eval_board);
+  }
+
+  printf("%lu boards (%lu visited)\n\n", n_boards, n_boards_visited);
+  for(int player_no = 0; player_no < n_players; player_no++) {
+    printf("  %d: %s equity %6.4lf%%\n", player_no, hole_strs[player_no], equities[player_no]/(double)n_boards * 100.0);
+  }
+  printf("\n  player 0 EV %+6.4lf\n", p0_profit/(double)n_boards);
+}
+
+int main(int argc, char* argv[]) {
+  // Exact equity of given hole cards, e.g. eval-10 AhKd QsQc 7c7d [all-boards]
+  if(argc > 2) {
+    bool canonical_boards = !(std::strcmp(argv[argc-1], "all-boards") == 0);
+    int n_players = canonical_boards ? argc-1 : argc-2;
+    eval_exact(n_players, argv+1, canonical_boards);
+    return 0;
+  }
+
   eval_p0_up_to_n_up(10);
   return 0;
 }
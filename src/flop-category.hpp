@@ -0,0 +1,273 @@
+#ifndef FLOP_CATEGORY_HPP
+#define FLOP_CATEGORY_HPP
+
+#include <algorithm>
+#include <string>
+
+#include "types.hpp"
+
+namespace Poker {
+  namespace FlopCategory {
+
+    // Chunked flop categories of a hold-em hand - see docs/flop-category-chunking.txt.
+    // A category is a made hand category augmented by the straight/flush potential that involves a
+    //   hole card. This stands in for the ~8000 flops per hole card class, at the cost of forgetting the
+    //   hole cards themselves.
+
+    // Made hand categories relative to the flop
+    enum MadeCategoryT {
+      // Pocket pairs
+      Overpair,
+      SecondPair,
+      ThirdPair,
+      Underpair,
+      TwoPairHigherPocketPair,
+      TwoPairLowerPocketPair,
+      PocketSet,
+      PocketFullHouse,
+      PocketQuads,
+      // Suited and off-suit
+      Nothing,
+      HighCard,
+      HighPair,
+      MiddlePair,
+      LowPair,
+      HighTwoPair,
+      MiddleTwoPair,
+      LowTwoPair,
+      Trips,
+      FullHouse,
+      Quads,
+      N_MADE_CATEGORIES
+    };
+
+    // Straight/flush potential, only where it includes a hole card.
+    // In 1 means one more card completes it, in 2 means it takes both the turn and the river.
+    enum DrawCategoryT {
+      NoDraw,
+      InnerStraightDrawIn1,
+      OuterStraightDrawIn1,
+      DoubleInnerStraightDrawIn2,
+      InnerOuterStraightDrawIn2,
+      DoubleOuterStraightDrawIn2,
+      HighFlushDrawIn1,
+      FlushDrawIn1,
+      HighFlushDrawIn2,
+      FlushDrawIn2,
+      Flush,
+      Straight,
+      N_DRAW_CATEGORIES
+    };
+
+    // Dense ids - not every combination can occur
+    const int N_FLOP_CATEGORIES = (int)N_MADE_CATEGORIES * (int)N_DRAW_CATEGORIES;
+
+    constexpr inline int flop_category(MadeCategoryT made, DrawCategoryT draw) {
+      return (int)made*(int)N_DRAW_CATEGORIES + (int)draw;
+    }
+
+    constexpr inline MadeCategoryT flop_category_made(int category) {
+      return (MadeCategoryT)(category / (int)N_DRAW_CATEGORIES);
+    }
+
+    constexpr inline DrawCategoryT flop_category_draw(int category) {
+      return (DrawCategoryT)(category % (int)N_DRAW_CATEGORIES);
+    }
+
+    [[maybe_unused]]
+    static const char* MADE_CATEGORY_NAMES[N_MADE_CATEGORIES] = {
+      "overpair", "2nd-pair", "3rd-pair", "underpair", "2-pair-hi-pocket", "2-pair-lo-pocket", "set", "pocket-full-house", "pocket-quads",
+      "nothing", "high-card", "high-pair", "middle-pair", "low-pair", "high-2-pair", "middle-2-pair", "low-2-pair", "trips", "full-house", "quads"
+    };
+
+    [[maybe_unused]]
+    static const char* DRAW_CATEGORY_NAMES[N_DRAW_CATEGORIES] = {
+      "", "inner-straight-draw", "outer-straight-draw", "double-inner-straight-draw-in-2", "inner-outer-straight-draw-in-2", "double-outer-straight-draw-in-2",
+      "high-flush-draw", "flush-draw", "high-flush-draw-in-2", "flush-draw-in-2", "flush", "straight"
+    };
+
+    inline std::string flop_category_name(int category) {
+      const DrawCategoryT draw = flop_category_draw(category);
+      return std::string(MADE_CATEGORY_NAMES[flop_category_made(category)]) + (draw == NoDraw ? "" : "+") + DRAW_CATEGORY_NAMES[draw];
+    }
+
+    // Ranks are compared aces-high
+    inline MadeCategoryT made_category(RankT hole0, RankT hole1, const RankT board[3]) {
+      // Distinct board ranks, highest first, and how many of each
+      RankT board_ranks[3];
+      int board_counts[3] = {};
+      int n_board_ranks = 0;
+      for(int i = 0; i < 3; i++) {
+	int j = 0;
+	while(j < n_board_ranks && board_ranks[j] != board[i]) {
+	  j++;
+	}
+	if(j == n_board_ranks) {
+	  board_ranks[n_board_ranks++] = board[i];
+	}
+	board_counts[j]++;
+      }
+      for(int i = 0; i < n_board_ranks; i++) {
+	for(int j = i+1; j < n_board_ranks; j++) {
+	  if(board_ranks[j] > board_ranks[i]) {
+	    std::swap(board_ranks[i], board_ranks[j]);
+	    std::swap(board_counts[i], board_counts[j]);
+	  }
+	}
+      }
+
+      auto board_count = [&](RankT rank) {
+	for(int i = 0; i < n_board_ranks; i++) {
+	  if(board_ranks[i] == rank) {
+	    return board_counts[i];
+	  }
+	}
+	return 0;
+      };
+      // 0 for the top board rank, then 1 and 2, but the lowest is always 2
+      auto board_position = [&](RankT rank) {
+	for(int i = 0; i < n_board_ranks; i++) {
+	  if(board_ranks[i] == rank) {
+	    return i == n_board_ranks-1 ? 2 : i;
+	  }
+	}
+	return -1;
+      };
+      bool is_board_paired = n_board_ranks < 3;
+      RankT board_pair_rank = board_counts[0] >= 2 ? board_ranks[0] : board_ranks[1];
+
+      if(hole0 == hole1) {
+	const int n_matches = board_count(hole0);
+	if(n_matches == 2) {
+	  return PocketQuads;
+	}
+	if(n_board_ranks == 1 || (n_matches == 1 && is_board_paired)) {
+	  return PocketFullHouse;
+	}
+	if(n_matches == 1) {
+	  return PocketSet;
+	}
+	if(is_board_paired) {
+	  return hole0 > board_pair_rank ? TwoPairHigherPocketPair : TwoPairLowerPocketPair;
+	}
+	if(hole0 > board_ranks[0]) {
+	  return Overpair;
+	}
+	return hole0 > board_ranks[1] ? SecondPair : hole0 > board_ranks[2] ? ThirdPair : Underpair;
+      }
+
+      const int n_matches0 = board_count(hole0);
+      const int n_matches1 = board_count(hole1);
+
+      if(n_matches0 == 3 || n_matches1 == 3) {
+	return Quads;
+      }
+      if((n_matches0 == 2 && n_matches1 == 1) || (n_matches0 == 1 && n_matches1 == 2)) {
+	return FullHouse;
+      }
+      if(n_matches0 == 2 || n_matches1 == 2) {
+	return Trips;
+      }
+
+      // Two pair - both hole cards pair the board, or one does on a paired board - by the highest we pair
+      const int n_paired = (n_matches0 == 1 ? 1 : 0) + (n_matches1 == 1 ? 1 : 0);
+      if(n_paired == 2 || (n_paired == 1 && is_board_paired)) {
+	const int position = std::min(n_matches0 == 1 ? board_position(hole0) : 2, n_matches1 == 1 ? board_position(hole1) : 2);
+	return position == 0 ? HighTwoPair : position == 1 ? MiddleTwoPair : LowTwoPair;
+      }
+      if(n_paired == 1) {
+	const int position = board_position(n_matches0 == 1 ? hole0 : hole1);
+	return position == 0 ? HighPair : position == 1 ? MiddlePair : LowPair;
+      }
+
+      return std::max(hole0, hole1) > board_ranks[0] ? HighCard : Nothing;
+    }
+
+    inline RankBitsT rank_bits(RankT rank) {
+      return RankBits[rank];
+    }
+
+    inline DrawCategoryT draw_category(const CardT hole[2], const CardT board[3]) {
+      // Flush potential by suit - only suits of the hole cards count
+      int best_suit_count = 0;
+      bool is_best_suit_high = false;
+      const int high_hole_no = to_ace_hi(hole[0].rank) >= to_ace_hi(hole[1].rank) ? 0 : 1;
+      for(int h = 0; h < 2; h++) {
+	const SuitT suit = hole[h].suit;
+	int suit_count = 0;
+	for(int i = 0; i < 2; i++) {
+	  suit_count += hole[i].suit == suit ? 1 : 0;
+	}
+	for(int i = 0; i < 3; i++) {
+	  suit_count += board[i].suit == suit ? 1 : 0;
+	}
+	const bool is_high = hole[high_hole_no].suit == suit;
+	if(suit_count > best_suit_count || (suit_count == best_suit_count && is_high)) {
+	  best_suit_count = suit_count;
+	  is_best_suit_high = is_high;
+	}
+      }
+
+      if(best_suit_count == 5) {
+	return Flush;
+      }
+
+      // Straight potential over every 5-rank window that holds at least one hole card.
+      // Aces are both low and high.
+      RankBitsT hole_bits = rank_bits(hole[0].rank) | rank_bits(hole[1].rank);
+      RankBitsT all_bits = hole_bits | rank_bits(board[0].rank) | rank_bits(board[1].rank) | rank_bits(board[2].rank);
+      bool is_straight = false;
+      RankBitsT in1_bits = 0;
+      // Distinct pairs of missing ranks of the draws in 2
+      RankBitsT in2_missing[10];
+      int n_in2 = 0;
+      for(int low = AceLow; low <= Ten; low++) {
+	const RankBitsT window = (RankBitsT)(0x1f << low);
+	if((window & hole_bits) == 0) {
+	  continue;
+	}
+	const RankBitsT missing = (RankBitsT)(window & ~all_bits);
+	const int n_missing = __builtin_popcount(missing);
+	if(n_missing == 0) {
+	  is_straight = true;
+	} else if(n_missing == 1) {
+	  in1_bits |= missing;
+	} else if(n_missing == 2 && std::find(in2_missing, in2_missing + n_in2, missing) == in2_missing + n_in2) {
+	  in2_missing[n_in2++] = missing;
+	}
+      }
+
+      // Complete flush/straight dominates draw in 1, which dominates draw in 2; flush (draw) dominates straight (draw)
+      if(is_straight) {
+	return Straight;
+      }
+      if(best_suit_count == 4) {
+	return is_best_suit_high ? HighFlushDrawIn1 : FlushDrawIn1;
+      }
+      if(in1_bits != 0) {
+	// Aces low and high are the same completing card
+	const int n_outs_ranks = __builtin_popcount(in1_bits & ~(1 << Ace)) + ((in1_bits & (1 << Ace)) != 0 && (in1_bits & (1 << AceLow)) == 0 ? 1 : 0);
+	return n_outs_ranks >= 2 ? OuterStraightDrawIn1 : InnerStraightDrawIn1;
+      }
+      if(best_suit_count == 3) {
+	return is_best_suit_high ? HighFlushDrawIn2 : FlushDrawIn2;
+      }
+      if(n_in2 != 0) {
+	return n_in2 == 1 ? DoubleInnerStraightDrawIn2 : n_in2 == 2 ? InnerOuterStraightDrawIn2 : DoubleOuterStraightDrawIn2;
+      }
+      return NoDraw;
+    }
+
+    // Flop category of hole cards on a flop
+    inline int holdem_flop_category(U8CardT hole0, U8CardT hole1, U8CardT flop0, U8CardT flop1, U8CardT flop2) {
+      const CardT hole[2] = { CardT(hole0), CardT(hole1) };
+      const CardT board[3] = { CardT(flop0), CardT(flop1), CardT(flop2) };
+      const RankT board_ranks[3] = { to_ace_hi(board[0].rank), to_ace_hi(board[1].rank), to_ace_hi(board[2].rank) };
+
+      return flop_category(made_category(to_ace_hi(hole[0].rank), to_ace_hi(hole[1].rank), board_ranks), draw_category(hole, board));
+    }
+
+  } // namespace FlopCategory
+} // namespace Poker
+
+#endif //ndef FLOP_CATEGORY_HPP
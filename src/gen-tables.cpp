@@ -0,0 +1,21 @@
+#include <cstdio>
+
+#include "holdem-equity.hpp"
+#include "normal.hpp"
+#include "table-file.hpp"
+
+using namespace Poker;
+
+// Generate all persisted tables into $POKERMON_TABLE_DIR (default the current directory),
+//   so that subsequent jobs just mmap them.
+int main() {
+  printf("Generating tables in %s\n", TableFile::table_dir().c_str());
+
+  Normal::load_omaha_hole_normal_from_index_table();
+  printf("  %s\n", TableFile::table_path("omaha-hole-normal-from-index").c_str());
+
+  Equity::load_holdem_preflop_equity_matrix();
+  printf("  %s\n", TableFile::table_path("holdem-preflop-equity").c_str());
+
+  return 0;
+}
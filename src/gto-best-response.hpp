@@ -0,0 +1,200 @@
+#ifndef GTO_BEST_RESPONSE
+#define GTO_BEST_RESPONSE
+
+#include <type_traits>
+
+#include "gto-common.hpp"
+#include "gto-eval.hpp"
+#include "holdem-equity.hpp"
+#include "normal.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Heads-up best response against a fixed opponent strategy over the preflop hole classes,
+    //   with exact all-in showdown equities.
+    //
+    // For one of the player's hole classes we walk the player's strategy tree together with
+    //   the opponent's strategy trees for all of its hole classes, carrying the opponent's reach
+    //   probability per opponent hole class (weighted by the number of hole hand pairs of the matchup).
+    // At the player's nodes the best response takes the most profitable action; at the opponent's
+    //   nodes the opponent's reach is split by its strategy.
+
+    const int N_BR_HOLE_CLASSES = (int)Normal::N_HOLDEM_HOLE_CLASSES;
+
+    // Inputs that are fixed for a traversal
+    struct HeadsUpBestResponseContext {
+      // The player whose value is computed
+      int player_no;
+      // Best respond, or else just follow the player's own strategy
+      bool is_best_response;
+      // Showdown outcomes of the player's hole class against each opponent hole class
+      HeadsUpShowdownEquity equities[N_BR_HOLE_CLASSES];
+    };
+
+    template <typename StrategyT, LimitHandNodeType NODE_TYPE = get_node_type(StrategyT::player_no, StrategyT::active_bm, StrategyT::n_to_call, StrategyT::n_raises_left)>
+    struct LimitHandBestResponse;
+
+    // Value of the child picked out by get_child, where the opponent's reach is scaled by get_p of
+    //   its strategy if the opponent is acting.
+    template <typename StrategyT, typename GetChildT, typename GetPT>
+    inline double heads_up_child_value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES], GetChildT get_child, GetPT get_p) {
+      typedef typename std::remove_const<typename std::remove_reference<decltype(get_child(own_strategy))>::type>::type ChildT;
+
+      const bool is_opp_action = StrategyT::player_no != ctx.player_no;
+
+      const ChildT* child_opp_strategies[N_BR_HOLE_CLASSES];
+      double child_opp_reach[N_BR_HOLE_CLASSES];
+      bool is_reached = false;
+      for(int c = 0; c < N_BR_HOLE_CLASSES; c++) {
+	child_opp_strategies[c] = &get_child(*opp_strategies[c]);
+	child_opp_reach[c] = is_opp_action ? opp_reach[c]*get_p(*opp_strategies[c]) : opp_reach[c];
+	is_reached = is_reached || child_opp_reach[c] != 0.0;
+      }
+
+      // No opponent gets here
+      if(!is_reached) {
+	return 0.0;
+      }
+
+      return LimitHandBestResponse<ChildT>::value(ctx, get_child(own_strategy), child_opp_strategies, child_opp_reach);
+    }
+
+    // The current player can fold, call or raise
+    template <typename StrategyT>
+    struct LimitHandBestResponse<StrategyT, FoldCallRaiseNodeType> {
+      static double value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES]) {
+	double fold_value = heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s.fold; }, [](const StrategyT& s) { return s.strategy.fold_p; });
+	double call_value = heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s.call; }, [](const StrategyT& s) { return s.strategy.call_p; });
+	double raise_value = heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s.raise; }, [](const StrategyT& s) { return s.strategy.raise_p; });
+
+	if(StrategyT::player_no != ctx.player_no) {
+	  return fold_value + call_value + raise_value;
+	}
+	if(ctx.is_best_response) {
+	  return std::max(fold_value, std::max(call_value, raise_value));
+	}
+	return own_strategy.strategy.fold_p*fold_value + own_strategy.strategy.call_p*call_value + own_strategy.strategy.raise_p*raise_value;
+      }
+    };
+
+    // The current player can only fold or call
+    template <typename StrategyT>
+    struct LimitHandBestResponse<StrategyT, FoldCallNodeType> {
+      static double value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES]) {
+	double fold_value = heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s.fold; }, [](const StrategyT& s) { return s.strategy.fold_p; });
+	double call_value = heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s.call; }, [](const StrategyT& s) { return s.strategy.call_p; });
+
+	if(StrategyT::player_no != ctx.player_no) {
+	  return fold_value + call_value;
+	}
+	if(ctx.is_best_response) {
+	  return std::max(fold_value, call_value);
+	}
+	return own_strategy.strategy.fold_p*fold_value + own_strategy.strategy.call_p*call_value;
+      }
+    };
+
+    // One player left - takes the pot regardless of hole cards
+    template <typename StrategyT>
+    struct LimitHandBestResponse<StrategyT, AllButOneFoldNodeType> {
+      static double value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES]) {
+	double total_opp_reach = 0.0;
+	for(int c = 0; c < N_BR_HOLE_CLASSES; c++) {
+	  total_opp_reach += opp_reach[c];
+	}
+
+	return total_opp_reach * make_player_profits_for_one_winner<2>(StrategyT::active_bm, StrategyT::player_pots_u64).profits[ctx.player_no];
+      }
+    };
+
+    // Showdown
+    template <typename StrategyT>
+    struct LimitHandBestResponse<StrategyT, ShowdownNodeType> {
+      static double value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES]) {
+	double value = 0.0;
+	for(int c = 0; c < N_BR_HOLE_CLASSES; c++) {
+	  if(opp_reach[c] != 0.0) {
+	    value += opp_reach[c] * make_player_profits_for_showdown<2>(StrategyT::active_bm, StrategyT::player_pots_u64, ctx.equities[c]).profits[ctx.player_no];
+	  }
+	}
+	return value;
+      }
+    };
+
+    // Player already folded - never happens heads-up, since the hand is then over
+    template <typename StrategyT>
+    struct LimitHandBestResponse<StrategyT, AlreadyFoldedNodeType> {
+      static double value(const HeadsUpBestResponseContext& ctx, const StrategyT& own_strategy, const StrategyT* const opp_strategies[N_BR_HOLE_CLASSES], const double opp_reach[N_BR_HOLE_CLASSES]) {
+	return heads_up_child_value(ctx, own_strategy, opp_strategies, opp_reach, [](const StrategyT& s) -> const auto& { return s._; }, [](const StrategyT& s) { return 1.0; });
+      }
+    };
+
+    // Values are in chips per hand
+    struct HeadsUpExploitabilityT {
+      // Value of the strategies for P0 - P1's value is the negation
+      double p0_value;
+      // Values of each player best responding to the other player's strategy
+      double p0_best_response_value;
+      double p1_best_response_value;
+
+      // How much P1 could gain against P0's strategy by best responding
+      inline double p0_exploitability() const { return p1_best_response_value + p0_value; }
+      // How much P0 could gain against P1's strategy by best responding
+      inline double p1_exploitability() const { return p0_best_response_value - p0_value; }
+      // Average gain of a best response over both seats - zero at equilibrium
+      inline double exploitability() const { return (p0_best_response_value + p1_best_response_value)/2.0; }
+    };
+
+    // @return the value of player_no over all hole classes in chips per hand, best responding or
+    //   following its own strategy according to is_best_response
+    template <typename RootStrategyT>
+    double heads_up_player_value(const PerHoleHandContainer<RootStrategyT>& hole_hand_strategies, int player_no, bool is_best_response) {
+      static_assert(RootStrategyT::n_players == 2, "best response is only implemented heads-up");
+
+      // Allocate on the heap cos this is large-ish and we're recursing
+      HeadsUpBestResponseContext* ctx = new HeadsUpBestResponseContext();
+      ctx->player_no = player_no;
+      ctx->is_best_response = is_best_response;
+
+      const RootStrategyT* opp_strategies[N_BR_HOLE_CLASSES];
+      for(int c = 0; c < N_BR_HOLE_CLASSES; c++) {
+	opp_strategies[c] = &hole_hand_strategies.get_class_value(c);
+      }
+
+      double total_value = 0.0;
+      double total_weight = 0.0;
+
+      for(int hole_class = 0; hole_class < N_BR_HOLE_CLASSES; hole_class++) {
+	double opp_reach[N_BR_HOLE_CLASSES];
+	for(int opp_class = 0; opp_class < N_BR_HOLE_CLASSES; opp_class++) {
+	  const Equity::HoldemClassMatchupT& matchup = player_no == 0 ? Equity::holdem_preflop_equity(hole_class, opp_class) : Equity::holdem_preflop_equity(opp_class, hole_class);
+	  ctx->equities[opp_class] = HeadsUpShowdownEquity{ matchup.p0_win_p(), matchup.tie_p(), matchup.p1_win_p() };
+	  opp_reach[opp_class] = (double)matchup.n_combo_pairs();
+	  total_weight += opp_reach[opp_class];
+	}
+
+	total_value += LimitHandBestResponse<RootStrategyT>::value(*ctx, hole_hand_strategies.get_class_value(hole_class), opp_strategies, opp_reach);
+      }
+
+      delete ctx;
+
+      return total_value/total_weight;
+    }
+
+    template <typename RootStrategyT>
+    HeadsUpExploitabilityT heads_up_exploitability(const PerHoleHandContainer<RootStrategyT>& hole_hand_strategies) {
+      HeadsUpExploitabilityT exploitability = {};
+      exploitability.p0_value = heads_up_player_value(hole_hand_strategies, /*player_no*/0, /*is_best_response*/false);
+      exploitability.p0_best_response_value = heads_up_player_value(hole_hand_strategies, /*player_no*/0, /*is_best_response*/true);
+      exploitability.p1_best_response_value = heads_up_player_value(hole_hand_strategies, /*player_no*/1, /*is_best_response*/true);
+      return exploitability;
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_BEST_RESPONSE
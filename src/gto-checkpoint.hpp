@@ -0,0 +1,124 @@
+#ifndef GTO_CHECKPOINT
+#define GTO_CHECKPOINT
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gto-eval.hpp"
+#include "gto-flat.hpp"
+#include "gto-strategy.hpp"
+#include "normal.hpp"
+#include "table-file.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Checkpoints of per-hole-class strategy trees, so that a solve can be resumed.
+    //
+    // A checkpoint is a table file (see TableFile) with a single element - a key identifying the game
+    //   tree, the progress of the solve, and the raw strategy trees including the CFR state. It is
+    //   only readable by a build with the same tree layout, which the key checks.
+
+    // Bump when the checkpoint layout or the strategy node layout changes
+    const u32 LIMIT_STRATEGY_CHECKPOINT_VERSION = 1;
+
+    // Identifies the game tree - a checkpoint only loads into the same tree
+    struct LimitStrategyCheckpointKeyT {
+      u32 n_players;
+      u32 small_blind;
+      u32 big_blind;
+      // At the root
+      u32 n_raises_left;
+      u32 n_nodes;
+      u32 n_hole_classes;
+      u32 strategy_size;
+      u32 reserved;
+
+      inline bool operator==(const LimitStrategyCheckpointKeyT& other) const {
+	return n_players == other.n_players && small_blind == other.small_blind && big_blind == other.big_blind
+	  && n_raises_left == other.n_raises_left && n_nodes == other.n_nodes && n_hole_classes == other.n_hole_classes
+	  && strategy_size == other.strategy_size;
+      }
+    };
+
+    template <typename RootStrategyT>
+    constexpr LimitStrategyCheckpointKeyT make_limit_strategy_checkpoint_key() {
+      return LimitStrategyCheckpointKeyT{
+	(u32)RootStrategyT::n_players,
+	(u32)RootStrategyT::small_blind,
+	(u32)RootStrategyT::big_blind,
+	(u32)RootStrategyT::n_raises_left,
+	(u32)LimitHandFlatLayout<RootStrategyT>::n_nodes,
+	(u32)Normal::N_HOLDEM_HOLE_CLASSES,
+	(u32)sizeof(RootStrategyT),
+	/*reserved*/0 };
+    }
+
+    template <typename RootStrategyT>
+    struct LimitStrategyCheckpointT {
+      LimitStrategyCheckpointKeyT key;
+      // Progress of the solve - the next round is round n_rounds_done
+      u32 n_rounds_done;
+      // StrategyAdjustT of the solve
+      u32 adjust;
+      PerHoleHandContainer<RootStrategyT> strategies;
+    };
+
+    // Conventional checkpoint file name for the tree, e.g. limit-2p-1-2-r4.ckpt
+    template <typename RootStrategyT>
+    std::string limit_strategy_checkpoint_name() {
+      return std::string("limit-") + std::to_string(RootStrategyT::n_players) + "p-" + std::to_string(RootStrategyT::small_blind) + "-" + std::to_string(RootStrategyT::big_blind) + "-r" + std::to_string(RootStrategyT::n_raises_left) + ".ckpt";
+    }
+
+    // Checkpoints live alongside the table files - see TableFile::table_dir()
+    template <typename RootStrategyT>
+    std::string limit_strategy_checkpoint_path() {
+      return TableFile::table_dir() + "/" + limit_strategy_checkpoint_name<RootStrategyT>();
+    }
+
+    // Write the checkpoint atomically.
+    // @return true on success
+    template <typename RootStrategyT>
+    bool write_limit_strategy_checkpoint(const std::string& path, const PerHoleHandContainer<RootStrategyT>& strategies, int n_rounds_done, StrategyAdjustT adjust) {
+      typedef LimitStrategyCheckpointT<RootStrategyT> CheckpointT;
+      static_assert(std::is_trivially_copyable<CheckpointT>::value, "checkpoints are raw memory images");
+
+      // Allocate on the heap cos this is large
+      std::vector<CheckpointT> checkpoint(1);
+      checkpoint[0].key = make_limit_strategy_checkpoint_key<RootStrategyT>();
+      checkpoint[0].n_rounds_done = (u32)n_rounds_done;
+      checkpoint[0].adjust = (u32)adjust;
+      checkpoint[0].strategies = strategies;
+
+      return TableFile::write_table(path, TableFile::GtoStrategyCheckpointTable, LIMIT_STRATEGY_CHECKPOINT_VERSION, sizeof(CheckpointT), /*n_elems*/1, checkpoint.data());
+    }
+
+    // Map the checkpoint read-only.
+    // @return the checkpoint, or nullptr if the file is missing, or is from a different version or game tree;
+    //   release with unmap_limit_strategy_checkpoint()
+    template <typename RootStrategyT>
+    const LimitStrategyCheckpointT<RootStrategyT>* map_limit_strategy_checkpoint(const std::string& path) {
+      typedef LimitStrategyCheckpointT<RootStrategyT> CheckpointT;
+
+      const CheckpointT* checkpoint = (const CheckpointT*)TableFile::map_table(path, TableFile::GtoStrategyCheckpointTable, LIMIT_STRATEGY_CHECKPOINT_VERSION, sizeof(CheckpointT), /*n_elems*/1);
+      if(checkpoint != nullptr && !(checkpoint->key == make_limit_strategy_checkpoint_key<RootStrategyT>())) {
+	TableFile::unmap_table(checkpoint, sizeof(CheckpointT), /*n_elems*/1);
+	return nullptr;
+      }
+
+      return checkpoint;
+    }
+
+    template <typename RootStrategyT>
+    void unmap_limit_strategy_checkpoint(const LimitStrategyCheckpointT<RootStrategyT>* checkpoint) {
+      TableFile::unmap_table(checkpoint, sizeof(LimitStrategyCheckpointT<RootStrategyT>), /*n_elems*/1);
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_CHECKPOINT
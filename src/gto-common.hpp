@@ -1,6 +1,9 @@
 #ifndef GTO_COMMON
 #define GTO_COMMON
 
+#include <algorithm>
+#include <random>
+
 #include "types.hpp"
 #include "hand-eval.hpp"
 
@@ -83,16 +86,17 @@ namespace Poker {
       return (u8) (1 << player_no);
     }
     
-    constexpr inline bool get_is_active(int player_no, u8 active_bm_u8) {
-      return (active_bm_u8 & active_bm_u8_mask(player_no)) != 0;
+    // Takes a u16 bitmap so that it also serves the runtime trees of up to 16 players - see gto-runtime-tree.hpp
+    constexpr inline bool get_is_active(int player_no, u16 active_bm) {
+      return (active_bm & (1 << player_no)) != 0;
     }
     
     constexpr inline u8 remove_player_from_active_bm(int player_no, u8 active_bm_u8) {
       return active_bm_u8 & ~active_bm_u8_mask(player_no);
     }
     
-    constexpr inline int get_n_active(u8 active_bm_u8) {
-      return __builtin_popcount(active_bm_u8);
+    constexpr inline int get_n_active(u16 active_bm) {
+      return __builtin_popcount(active_bm);
     }
 
     constexpr inline u8 make_root_active_bm(int n_players) {
@@ -104,12 +108,14 @@ namespace Poker {
       FoldCallNodeType,
       AllButOneFoldNodeType,
       ShowdownNodeType,
-      AlreadyFoldedNodeType
+      AlreadyFoldedNodeType,
+      // Chance node dealing the flop - only in runtime trees with a postflop stage, see gto-runtime-tree.hpp
+      FlopDealNodeType
     };
 
-    constexpr inline LimitHandNodeType get_node_type(int player_no, u8 active_bm_u8, int n_to_call, int n_raises_left) {
+    constexpr inline LimitHandNodeType get_node_type(int player_no, u16 active_bm, int n_to_call, int n_raises_left) {
       // Highest priority specialisation - only one player left
-      int n_active = get_n_active(active_bm_u8);
+      int n_active = get_n_active(active_bm);
       if(n_active == 1) {
 	return AllButOneFoldNodeType;
       }
@@ -118,7 +124,7 @@ namespace Poker {
 	return ShowdownNodeType;
       }
       // Has the current player already folded - if so this is a dummy node
-      bool is_active = get_is_active(player_no, active_bm_u8);
+      bool is_active = get_is_active(player_no, active_bm);
       if(!is_active) {
 	return AlreadyFoldedNodeType;
       }
@@ -140,6 +146,13 @@ namespace Poker {
 	}
       }
       
+      // Merge the results of another (independent) evaluation into this one
+      inline void merge(const NodeEvalPerPlayerProfit<N_PLAYERS>& other) {
+	for(int i = 0; i < N_PLAYERS; i++) {
+	  profits[i] += other.profits[i];
+	}
+      }
+      
     };
 
     // Only valid if active_bm_u8 has only a single bit set
@@ -179,6 +192,13 @@ namespace Poker {
 
 	player_profits.accumulate(hand_activity, hand_profits);
       }
+
+      // Merge the results of another (independent) evaluation into this one
+      inline void merge(const NodeEval<N_PLAYERS>& other) {
+	activity += other.activity;
+
+	player_profits.merge(other.player_profits);
+      }
     };
     
     template <
@@ -217,6 +237,7 @@ namespace Poker {
       static constexpr int n_to_call = N_TO_CALL;
       static constexpr int player_no = PLAYER_NO;
       static constexpr int n_raises_left = N_RAISES_LEFT;
+      static constexpr u64 player_pots_u64 = PLAYER_POTS;
       static constexpr PlayerPots<N_PLAYERS> player_pots = make_player_pots<N_PLAYERS>(PLAYER_POTS);
       static constexpr int curr_max_bet = get_curr_max_bet(N_PLAYERS, PLAYER_POTS);
       static constexpr int total_pot = player_pots.get_total_pot();
@@ -284,13 +305,94 @@ namespace Poker {
 	PlayerStrategies<N_PLAYERS, dead_t> dead_strategies = {};
 	
 	for(int n = 0; n < N_PLAYERS; n++) {
-	  dead_strategies.strategies[n] = &strategies.strategies[n]->dead;
+	  dead_strategies.strategies[n] = &strategies.strategies[n]->_;
 	}
 	
 	return dead_strategies;
       }
     };
     
+    // Probabilities of reaching a node.
+    // Each player's reach is the product of its own strategy probabilities on the path to the node,
+    //   and the chance probability (deal weight) is common to all players.
+    template <int N_PLAYERS>
+    struct PlayerReach {
+      double chance_p;
+      double reach_p[N_PLAYERS];
+      // Reach probabilities at or below this count as unreachable - 0.0 for no pruning.
+      // Pruned subtrees are left out of the evals, which is only an approximation unless the
+      //   caller periodically evaluates without pruning.
+      double prune_p;
+
+      // Probability of reaching the node if player_no plays to reach it.
+      // This is the weight of the node in player_no's evals, so that player_no's relative profits are
+      //   counterfactual values - still defined where player_no's own strategy never gets here.
+      inline double cf_reach_p(int player_no) const {
+	double p = chance_p;
+	for(int n = 0; n < N_PLAYERS; n++) {
+	  if(n != player_no) {
+	    p *= reach_p[n];
+	  }
+	}
+	return p;
+      }
+
+      // Reach probabilities after player_no takes an action with probability action_p
+      inline PlayerReach<N_PLAYERS> after_action(int player_no, double action_p) const {
+	PlayerReach<N_PLAYERS> reach = *this;
+	reach.reach_p[player_no] *= action_p;
+	return reach;
+      }
+
+      // True iff every player's counterfactual reach is (close to) zero, i.e. (almost) nothing is learned below here
+      inline bool is_pruned() const {
+	if(chance_p == 0.0) {
+	  return true;
+	}
+	int n_unreached = 0;
+	for(int n = 0; n < N_PLAYERS; n++) {
+	  if(reach_p[n] <= prune_p) {
+	    n_unreached++;
+	  }
+	}
+	return n_unreached > 1;
+      }
+    };
+
+    // Pick one of the actions of a node at random with the given probabilities - fold, call[, raise].
+    // Never picks an action with zero probability, even if the probabilities don't quite sum to one.
+    template <int N_ACTIONS, typename RngT>
+    inline int sample_action(const double action_ps[N_ACTIONS], RngT& rng) {
+      double total_p = 0.0;
+      int last_action = 0;
+      for(int a = 0; a < N_ACTIONS; a++) {
+	total_p += action_ps[a];
+	if(action_ps[a] > 0.0) {
+	  last_action = a;
+	}
+      }
+
+      double u = std::uniform_real_distribution<double>(0.0, total_p)(rng);
+      for(int a = 0; a < last_action; a++) {
+	if(u < action_ps[a]) {
+	  return a;
+	}
+	u -= action_ps[a];
+      }
+      return last_action;
+    }
+
+    template <int N_PLAYERS>
+    inline PlayerReach<N_PLAYERS> make_root_reach(double chance_p, double prune_p = 0.0) {
+      PlayerReach<N_PLAYERS> reach = {};
+      reach.chance_p = chance_p;
+      for(int n = 0; n < N_PLAYERS; n++) {
+	reach.reach_p[n] = 1.0;
+      }
+      reach.prune_p = prune_p;
+      return reach;
+    }
+
     template <int N_PLAYERS, typename PlayerEvalT>
     struct PlayerEvals {
       PlayerEvalT* evals[N_PLAYERS];
@@ -299,9 +401,10 @@ namespace Poker {
 	return *evals[player_no];
       }
 
-      inline void accumulate(double node_prob, const NodeEvalPerPlayerProfit<N_PLAYERS> player_profits) {
+      // Each player's eval is weighted by that player's counterfactual reach
+      inline void accumulate(const PlayerReach<N_PLAYERS>& reach, const NodeEvalPerPlayerProfit<N_PLAYERS> player_profits) {
 	for(int n = 0; n < N_PLAYERS; n++) {
-	  evals[n]->eval.accumulate(node_prob, player_profits);
+	  evals[n]->eval.accumulate(reach.cf_reach_p(n), player_profits);
 	}
       }
     };
@@ -359,7 +462,7 @@ namespace Poker {
 	PlayerEvals<N_PLAYERS, dead_t> dead_evals = {};
 	
 	for(int n = 0; n < N_PLAYERS; n++) {
-	  dead_evals.evals[n] = &evals.evals[n]->dead;
+	  dead_evals.evals[n] = &evals.evals[n]->_;
 	}
 	
 	return dead_evals;
@@ -380,6 +483,14 @@ namespace Poker {
     struct PlayerHandEvals {
       HandEval::HandEvalT evals[N_PLAYERS];
     };
+
+    // Showdown outcome probabilities of a heads-up hand, used in place of PlayerHandEvals to
+    //   evaluate a hole hand matchup against all boards at once.
+    struct HeadsUpShowdownEquity {
+      double p0_win_p;
+      double tie_p;
+      double p1_win_p;
+    };
   } // namespace Gto
   
 } // namespace Poker
@@ -0,0 +1,153 @@
+#ifndef GTO_DEAL_CLUMPS
+#define GTO_DEAL_CLUMPS
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Adaptive clumping of the card combos of a deal node - see docs/deal-chunking.txt.
+    //
+    // Every combo starts in a single clump, which the strategy tree below the deal node treats as one
+    //   class - as if the player knows nothing about the deal. We keep the EV of every combo, and once a
+    //   clump has seen enough action it is split at the mid-point of the EVs of its combos. The subtree
+    //   state of the new clump is cloned from the old one.
+    // A clump is an EV range - [lower_ev, upper_ev) - and combos are re-bucketed after every round into
+    //   the clump whose range holds their EV, since the EV order of the combos moves as strategies change.
+
+    struct DealClumpT {
+      double lower_ev;
+      double upper_ev;
+      // Since the clump was created or last split
+      double activity;
+    };
+
+    struct DealClumpsT {
+      // Clumps are the classes of the strategy tree below the deal node, so this bounds its size
+      int max_clumps;
+      // Indexed by clump number - new clumps are appended so that existing clump numbers are stable
+      std::vector<DealClumpT> clumps;
+      // Per combo
+      std::vector<int> combo_clumps;
+      std::vector<double> combo_profits;
+      std::vector<double> combo_activity;
+
+      DealClumpsT(int n_combos, int max_clumps):
+	max_clumps(max_clumps),
+	clumps(1, DealClumpT{ -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), 0.0 }),
+	combo_clumps(n_combos, 0), combo_profits(n_combos), combo_activity(n_combos) {}
+
+      inline int n_clumps() const { return (int)clumps.size(); }
+
+      inline int get_clump(int combo) const { return combo_clumps[combo]; }
+
+      // Mean profit of the combo over all rounds, or NaN if it's never been dealt
+      inline double get_combo_ev(int combo) const {
+	return combo_activity[combo] == 0.0 ? std::numeric_limits<double>::quiet_NaN() : combo_profits[combo]/combo_activity[combo];
+      }
+
+      // Profit of one traversal of the deal node with the combo dealt
+      inline void add(int combo, double profit) {
+	combo_profits[combo] += profit;
+	combo_activity[combo] += 1.0;
+	clumps[combo_clumps[combo]].activity += 1.0;
+      }
+
+      // Move every combo to the clump whose EV range holds its EV
+      inline void rebucket() {
+	for(int combo = 0; combo < (int)combo_clumps.size(); combo++) {
+	  const double ev = get_combo_ev(combo);
+	  if(std::isnan(ev)) {
+	    continue;
+	  }
+	  for(int clump = 0; clump < n_clumps(); clump++) {
+	    if(clumps[clump].lower_ev <= ev && ev < clumps[clump].upper_ev) {
+	      combo_clumps[combo] = clump;
+	      break;
+	    }
+	  }
+	}
+      }
+
+      // The clump with the next higher EV range, or -1 for the highest
+      inline int get_higher_clump(int clump) const {
+	for(int other = 0; other < n_clumps(); other++) {
+	  if(clumps[other].lower_ev == clumps[clump].upper_ev) {
+	    return other;
+	  }
+	}
+	return -1;
+      }
+
+      // Split the clump at the mid-point of its combos' EVs.
+      // @return the new clump holding the upper half, or -1 if the clump's combos all have the same EV
+      inline int split(int clump) {
+	double min_ev = std::numeric_limits<double>::infinity();
+	double max_ev = -std::numeric_limits<double>::infinity();
+	for(int combo = 0; combo < (int)combo_clumps.size(); combo++) {
+	  const double ev = get_combo_ev(combo);
+	  if(combo_clumps[combo] == clump && !std::isnan(ev)) {
+	    min_ev = std::min(min_ev, ev);
+	    max_ev = std::max(max_ev, ev);
+	  }
+	}
+	if(!(min_ev < max_ev)) {
+	  return -1;
+	}
+
+	const double mid_ev = (min_ev + max_ev)/2.0;
+	const int new_clump = n_clumps();
+	clumps.push_back(DealClumpT{ mid_ev, clumps[clump].upper_ev, 0.0 });
+	clumps[clump].upper_ev = mid_ev;
+	clumps[clump].activity = 0.0;
+
+	for(int combo = 0; combo < (int)combo_clumps.size(); combo++) {
+	  if(combo_clumps[combo] == clump && get_combo_ev(combo) >= mid_ev) {
+	    combo_clumps[combo] = new_clump;
+	  }
+	}
+
+	return new_clump;
+      }
+    };
+
+    // Re-bucket the combos after a round and then split every clump that has seen split_activity since
+    //   it was created or last split, while there's room.
+    // We don't split a clump that only ever checks or folds if the next higher EV clump doesn't either -
+    //   there's nothing to learn.
+    // @param is_default(clump) is whether the subtree strategy of a clump only checks or folds
+    // @param clone(from_clump, to_clump) copies the subtree state of a split clump to its new clump
+    // @return the number of clumps split
+    template <typename IsDefaultFnT, typename CloneFnT>
+    inline int adjust_deal_clumps(DealClumpsT& deal_clumps, double split_activity, IsDefaultFnT is_default, CloneFnT clone) {
+      deal_clumps.rebucket();
+
+      int n_splits = 0;
+      const int n_clumps = deal_clumps.n_clumps();
+      for(int clump = 0; clump < n_clumps && deal_clumps.n_clumps() < deal_clumps.max_clumps; clump++) {
+	if(deal_clumps.clumps[clump].activity < split_activity) {
+	  continue;
+	}
+	const int higher_clump = deal_clumps.get_higher_clump(clump);
+	if(is_default(clump) && higher_clump != -1 && is_default(higher_clump)) {
+	  continue;
+	}
+	const int new_clump = deal_clumps.split(clump);
+	if(new_clump != -1) {
+	  clone(clump, new_clump);
+	  n_splits++;
+	}
+      }
+
+      return n_splits;
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_DEAL_CLUMPS
@@ -2,6 +2,7 @@
 #define GTO_EVAL
 
 #include "gto-common.hpp"
+#include "normal.hpp"
 #include "types.hpp"
 
 namespace Poker {
@@ -194,43 +195,124 @@ namespace Poker {
       
       NodeEval<N_PLAYERS> eval;
 
-      template <typename PlayerEvalT, typename PlayerStrategyT>
-      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(double node_prob, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome) {
 	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = {};
 
 	const PlayerStrategyT& curr_player_strategy = player_strategies.get_player_strategy(PLAYER_NO);
 
 	double fold_p = curr_player_strategy.strategy.fold_p;
-	if(fold_p != 0.0) {
+	PlayerReach<N_PLAYERS> fold_reach = reach.after_action(PLAYER_NO, fold_p);
+	if(!fold_reach.is_pruned()) {
 	  auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
 	  auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
 	  typedef typename PlayerEvalT::fold_t eval_fold_t;
-	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::evaluate_hand(node_prob*fold_p, fold_evals, fold_strategies, player_hand_evals);
+	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::evaluate_hand(fold_reach, fold_evals, fold_strategies, hand_outcome);
 	  player_profits.accumulate(fold_p, fold_profits);
 	}
 
 	double call_p = curr_player_strategy.strategy.call_p;
-	if(call_p != 0.0) {
+	PlayerReach<N_PLAYERS> call_reach = reach.after_action(PLAYER_NO, call_p);
+	if(!call_reach.is_pruned()) {
 	  auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
 	  auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
 	  typedef typename PlayerEvalT::call_t eval_call_t;
-	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::evaluate_hand(node_prob*call_p, call_evals, call_strategies, player_hand_evals);
+	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::evaluate_hand(call_reach, call_evals, call_strategies, hand_outcome);
 	  player_profits.accumulate(call_p, call_profits);
 	}
 
 	double raise_p = curr_player_strategy.strategy.raise_p;
-	if(raise_p != 0.0) {
+	PlayerReach<N_PLAYERS> raise_reach = reach.after_action(PLAYER_NO, raise_p);
+	if(!raise_reach.is_pruned()) {
 	  auto raise_evals = PlayerEvalsRaiseGetter<N_PLAYERS, PlayerEvalT>::get_raise_evals(player_evals);
 	  auto raise_strategies = PlayerStrategiesRaiseGetter<N_PLAYERS, PlayerStrategyT>::get_raise_strategies(player_strategies);
 	  typedef typename PlayerEvalT::raise_t eval_raise_t;
-	  NodeEvalPerPlayerProfit<N_PLAYERS> raise_profits = eval_raise_t::evaluate_hand(node_prob*raise_p, raise_evals, raise_strategies, player_hand_evals);
+	  NodeEvalPerPlayerProfit<N_PLAYERS> raise_profits = eval_raise_t::evaluate_hand(raise_reach, raise_evals, raise_strategies, hand_outcome);
 	  player_profits.accumulate(raise_p, raise_profits);
 	}
 	
-	player_evals.accumulate(node_prob, player_profits);
+	player_evals.accumulate(reach, player_profits);
 
 	return player_profits;
       }
+
+      // External sampling Monte Carlo CFR - as evaluate_hand() but only the traverser's evals are accumulated,
+      //   and every other player plays a single action sampled from its strategy, so that the cost of a
+      //   traversal grows with the traverser's own branching rather than with the size of the tree.
+      // The traverser's evals are then unbiased estimates of its counterfactual values.
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT, typename RngT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> sample_hand(int traverser_no, const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome, RngT& rng) {
+	const PlayerStrategyT& curr_player_strategy = player_strategies.get_player_strategy(PLAYER_NO);
+	const double action_ps[3] = { curr_player_strategy.strategy.fold_p, curr_player_strategy.strategy.call_p, curr_player_strategy.strategy.raise_p };
+
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = {};
+
+	// An opponent of the traverser plays one action sampled from its strategy.
+	// Its reach probability is left as is, since the sampling stands in for it.
+	if(PLAYER_NO != traverser_no) {
+	  switch(sample_action<3>(action_ps, rng)) {
+	  case 0: {
+	    auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
+	    auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
+	    typedef typename PlayerEvalT::fold_t eval_fold_t;
+	    player_profits = eval_fold_t::sample_hand(traverser_no, reach, fold_evals, fold_strategies, hand_outcome, rng);
+	    break;
+	  }
+	  case 1: {
+	    auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
+	    auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
+	    typedef typename PlayerEvalT::call_t eval_call_t;
+	    player_profits = eval_call_t::sample_hand(traverser_no, reach, call_evals, call_strategies, hand_outcome, rng);
+	    break;
+	  }
+	  default: {
+	    auto raise_evals = PlayerEvalsRaiseGetter<N_PLAYERS, PlayerEvalT>::get_raise_evals(player_evals);
+	    auto raise_strategies = PlayerStrategiesRaiseGetter<N_PLAYERS, PlayerStrategyT>::get_raise_strategies(player_strategies);
+	    typedef typename PlayerEvalT::raise_t eval_raise_t;
+	    player_profits = eval_raise_t::sample_hand(traverser_no, reach, raise_evals, raise_strategies, hand_outcome, rng);
+	    break;
+	  }
+	  }
+	  player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	  return player_profits;
+	}
+
+	// The traverser tries every action, including those it never plays, so that they all have values
+	{
+	  auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
+	  auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
+	  typedef typename PlayerEvalT::fold_t eval_fold_t;
+	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::sample_hand(traverser_no, reach.after_action(PLAYER_NO, action_ps[0]), fold_evals, fold_strategies, hand_outcome, rng);
+	  player_profits.accumulate(action_ps[0], fold_profits);
+	}
+	{
+	  auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
+	  auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
+	  typedef typename PlayerEvalT::call_t eval_call_t;
+	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::sample_hand(traverser_no, reach.after_action(PLAYER_NO, action_ps[1]), call_evals, call_strategies, hand_outcome, rng);
+	  player_profits.accumulate(action_ps[1], call_profits);
+	}
+	{
+	  auto raise_evals = PlayerEvalsRaiseGetter<N_PLAYERS, PlayerEvalT>::get_raise_evals(player_evals);
+	  auto raise_strategies = PlayerStrategiesRaiseGetter<N_PLAYERS, PlayerStrategyT>::get_raise_strategies(player_strategies);
+	  typedef typename PlayerEvalT::raise_t eval_raise_t;
+	  NodeEvalPerPlayerProfit<N_PLAYERS> raise_profits = eval_raise_t::sample_hand(traverser_no, reach.after_action(PLAYER_NO, action_ps[2]), raise_evals, raise_strategies, hand_outcome, rng);
+	  player_profits.accumulate(action_ps[2], raise_profits);
+	}
+
+	player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	return player_profits;
+      }
+
+      // Merge the results of another (independent) evaluation into this one
+      inline void merge(const LimitHandEvalSpecialised& other) {
+	eval.merge(other.eval);
+	this->fold.merge(other.fold);
+	this->call.merge(other.call);
+	this->raise.merge(other.raise);
+      }
       
     };
     
@@ -254,15 +336,29 @@ namespace Poker {
       
       NodeEval<N_PLAYERS> eval;
 
-      template <typename PlayerEvalT, typename PlayerStrategyT>
-      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(double node_prob, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome) {
 	// The single player remaining takes the pot.
 	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = make_player_profits_for_one_winner<N_PLAYERS>(ACTIVE_BM, PLAYER_POTS);
 	
-	player_evals.accumulate(node_prob, player_profits);
+	player_evals.accumulate(reach, player_profits);
+
+	return player_profits;
+      }
+
+      // External sampling - see the FoldCallRaiseNodeType specialisation
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT, typename RngT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> sample_hand(int traverser_no, const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome, RngT& rng) {
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = make_player_profits_for_one_winner<N_PLAYERS>(ACTIVE_BM, PLAYER_POTS);
+
+	player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
 
 	return player_profits;
       }
+
+      inline void merge(const LimitHandEvalSpecialised& other) {
+	eval.merge(other.eval);
+      }
     
     };
 
@@ -308,14 +404,12 @@ namespace Poker {
       return active_winners_bm_u8;
     }
     
-    // Only valid if active_bm_u8 has at least one bit set
+    // Only valid if winners_bm_u8 has at least one bit set
     template <int N_PLAYERS>
-    inline NodeEvalPerPlayerProfit<N_PLAYERS> make_player_profits_for_showdown(u8 active_bm_u8, u64 player_pots_u64, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+    inline NodeEvalPerPlayerProfit<N_PLAYERS> make_player_profits_for_winners(u8 winners_bm_u8, u64 player_pots_u64) {
       PlayerPots<N_PLAYERS> player_pots = make_player_pots<N_PLAYERS>(player_pots_u64);
       int total_pot = player_pots.get_total_pot();
 
-      u8 winners_bm_u8 = get_active_winners_bm<N_PLAYERS>(active_bm_u8, player_hand_evals);
-
       // First pass - accumulate the winners' total pots
       int winners_total_pot = 0;
       for(int n = 0; n < N_PLAYERS; n++) {
@@ -340,6 +434,27 @@ namespace Poker {
       
       return player_profits;
     }
+
+    // Only valid if active_bm_u8 has at least one bit set
+    template <int N_PLAYERS>
+    inline NodeEvalPerPlayerProfit<N_PLAYERS> make_player_profits_for_showdown(u8 active_bm_u8, u64 player_pots_u64, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      u8 winners_bm_u8 = get_active_winners_bm<N_PLAYERS>(active_bm_u8, player_hand_evals);
+
+      return make_player_profits_for_winners<N_PLAYERS>(winners_bm_u8, player_pots_u64);
+    }
+
+    // Expected profits over the showdown outcome probabilities - heads-up showdowns always have both players active
+    template <int N_PLAYERS>
+    inline NodeEvalPerPlayerProfit<N_PLAYERS> make_player_profits_for_showdown(u8 active_bm_u8, u64 player_pots_u64, const HeadsUpShowdownEquity& equity) {
+      static_assert(N_PLAYERS == 2, "showdown equity is only defined heads-up");
+
+      NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = {};
+      player_profits.accumulate(equity.p0_win_p, make_player_profits_for_winners<N_PLAYERS>(active_bm_u8_mask(0), player_pots_u64));
+      player_profits.accumulate(equity.tie_p, make_player_profits_for_winners<N_PLAYERS>(active_bm_u8, player_pots_u64));
+      player_profits.accumulate(equity.p1_win_p, make_player_profits_for_winners<N_PLAYERS>(active_bm_u8_mask(1), player_pots_u64));
+
+      return player_profits;
+    }
     
     // Specialisation for all active players called.
     // Betting is now over and we go to showdown or the next stage.
@@ -360,15 +475,29 @@ namespace Poker {
       
       NodeEval<N_PLAYERS> eval;
 
-      template <typename PlayerEvalT, typename PlayerStrategyT>
-      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(double node_prob, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome) {
 	// The active top-ranked players share the pot
-	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = make_player_profits_for_showdown<N_PLAYERS>(ACTIVE_BM, PLAYER_POTS, player_hand_evals);
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = make_player_profits_for_showdown<N_PLAYERS>(ACTIVE_BM, PLAYER_POTS, hand_outcome);
 	
-	player_evals.accumulate(node_prob, player_profits);
+	player_evals.accumulate(reach, player_profits);
 
 	return player_profits;
       }
+
+      // External sampling - see the FoldCallRaiseNodeType specialisation
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT, typename RngT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> sample_hand(int traverser_no, const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome, RngT& rng) {
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = make_player_profits_for_showdown<N_PLAYERS>(ACTIVE_BM, PLAYER_POTS, hand_outcome);
+
+	player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	return player_profits;
+      }
+
+      inline void merge(const LimitHandEvalSpecialised& other) {
+	eval.merge(other.eval);
+      }
       
     };
     
@@ -402,13 +531,40 @@ namespace Poker {
       
       dead_t _;
 
-      template <typename PlayerEvalT, typename PlayerStrategyT>
-      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(double node_prob, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      // Same as the child's eval - kept so that the parent's strategy adjustment can read the value of
+      //   the action leading here like any other
+      NodeEval<N_PLAYERS> eval;
+
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome) {
 	auto dead_evals = PlayerEvalsDeadGetter<N_PLAYERS, PlayerEvalT>::get_dead_evals(player_evals);
 	auto dead_strategies = PlayerStrategiesDeadGetter<N_PLAYERS, PlayerStrategyT>::get_dead_strategies(player_strategies);
 	typedef typename PlayerEvalT::dead_t eval_dead_t;
 	
-	return eval_dead_t::evaluate_hand(node_prob, dead_evals, dead_strategies, player_hand_evals);
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = eval_dead_t::evaluate_hand(reach, dead_evals, dead_strategies, hand_outcome);
+
+	player_evals.accumulate(reach, player_profits);
+
+	return player_profits;
+      }
+
+      // External sampling - see the FoldCallRaiseNodeType specialisation
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT, typename RngT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> sample_hand(int traverser_no, const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome, RngT& rng) {
+	auto dead_evals = PlayerEvalsDeadGetter<N_PLAYERS, PlayerEvalT>::get_dead_evals(player_evals);
+	auto dead_strategies = PlayerStrategiesDeadGetter<N_PLAYERS, PlayerStrategyT>::get_dead_strategies(player_strategies);
+	typedef typename PlayerEvalT::dead_t eval_dead_t;
+
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = eval_dead_t::sample_hand(traverser_no, reach, dead_evals, dead_strategies, hand_outcome, rng);
+
+	player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	return player_profits;
+      }
+
+      inline void merge(const LimitHandEvalSpecialised& other) {
+	eval.merge(other.eval);
+	_.merge(other._);
       }
     
     };
@@ -436,34 +592,95 @@ namespace Poker {
       
       NodeEval<N_PLAYERS> eval;
 
-      template <typename PlayerEvalT, typename PlayerStrategyT>
-      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(double node_prob, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const PlayerHandEvals<N_PLAYERS>& player_hand_evals) {
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> evaluate_hand(const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome) {
 	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = {};
 
 	const PlayerStrategyT& curr_player_strategy = player_strategies.get_player_strategy(PLAYER_NO);
 
 	double fold_p = curr_player_strategy.strategy.fold_p;
-	if(fold_p != 0.0) {
+	PlayerReach<N_PLAYERS> fold_reach = reach.after_action(PLAYER_NO, fold_p);
+	if(!fold_reach.is_pruned()) {
 	  auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
 	  auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
 	  typedef typename PlayerEvalT::fold_t eval_fold_t;
-	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::evaluate_hand(node_prob*fold_p, fold_evals, fold_strategies, player_hand_evals);
+	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::evaluate_hand(fold_reach, fold_evals, fold_strategies, hand_outcome);
 	  player_profits.accumulate(fold_p, fold_profits);
 	}
 
 	double call_p = curr_player_strategy.strategy.call_p;
-	if(call_p != 0.0) {
+	PlayerReach<N_PLAYERS> call_reach = reach.after_action(PLAYER_NO, call_p);
+	if(!call_reach.is_pruned()) {
 	  auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
 	  auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
 	  typedef typename PlayerEvalT::call_t eval_call_t;
-	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::evaluate_hand(node_prob*call_p, call_evals, call_strategies, player_hand_evals);
+	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::evaluate_hand(call_reach, call_evals, call_strategies, hand_outcome);
 	  player_profits.accumulate(call_p, call_profits);
 	}
 
-	player_evals.accumulate(node_prob, player_profits);
+	player_evals.accumulate(reach, player_profits);
 
 	return player_profits;
       }
+
+      // External sampling - see the FoldCallRaiseNodeType specialisation
+      template <typename PlayerEvalT, typename PlayerStrategyT, typename HandOutcomeT, typename RngT>
+      static inline NodeEvalPerPlayerProfit<N_PLAYERS> sample_hand(int traverser_no, const PlayerReach<N_PLAYERS>& reach, PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerStrategies<N_PLAYERS, PlayerStrategyT>& player_strategies, const HandOutcomeT& hand_outcome, RngT& rng) {
+	const PlayerStrategyT& curr_player_strategy = player_strategies.get_player_strategy(PLAYER_NO);
+	const double action_ps[2] = { curr_player_strategy.strategy.fold_p, curr_player_strategy.strategy.call_p };
+
+	NodeEvalPerPlayerProfit<N_PLAYERS> player_profits = {};
+
+	// An opponent of the traverser plays one action sampled from its strategy.
+	// Its reach probability is left as is, since the sampling stands in for it.
+	if(PLAYER_NO != traverser_no) {
+	  switch(sample_action<2>(action_ps, rng)) {
+	  case 0: {
+	    auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
+	    auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
+	    typedef typename PlayerEvalT::fold_t eval_fold_t;
+	    player_profits = eval_fold_t::sample_hand(traverser_no, reach, fold_evals, fold_strategies, hand_outcome, rng);
+	    break;
+	  }
+	  default: {
+	    auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
+	    auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
+	    typedef typename PlayerEvalT::call_t eval_call_t;
+	    player_profits = eval_call_t::sample_hand(traverser_no, reach, call_evals, call_strategies, hand_outcome, rng);
+	    break;
+	  }
+	  }
+	  player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	  return player_profits;
+	}
+
+	// The traverser tries every action, including those it never plays, so that they all have values
+	{
+	  auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
+	  auto fold_strategies = PlayerStrategiesFoldGetter<N_PLAYERS, PlayerStrategyT>::get_fold_strategies(player_strategies);
+	  typedef typename PlayerEvalT::fold_t eval_fold_t;
+	  NodeEvalPerPlayerProfit<N_PLAYERS> fold_profits = eval_fold_t::sample_hand(traverser_no, reach.after_action(PLAYER_NO, action_ps[0]), fold_evals, fold_strategies, hand_outcome, rng);
+	  player_profits.accumulate(action_ps[0], fold_profits);
+	}
+	{
+	  auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
+	  auto call_strategies = PlayerStrategiesCallGetter<N_PLAYERS, PlayerStrategyT>::get_call_strategies(player_strategies);
+	  typedef typename PlayerEvalT::call_t eval_call_t;
+	  NodeEvalPerPlayerProfit<N_PLAYERS> call_profits = eval_call_t::sample_hand(traverser_no, reach.after_action(PLAYER_NO, action_ps[1]), call_evals, call_strategies, hand_outcome, rng);
+	  player_profits.accumulate(action_ps[1], call_profits);
+	}
+
+	player_evals.get_player_eval(traverser_no).eval.accumulate(reach.cf_reach_p(traverser_no), player_profits);
+
+	return player_profits;
+      }
+
+      inline void merge(const LimitHandEvalSpecialised& other) {
+	eval.merge(other.eval);
+	this->fold.merge(other.fold);
+	this->call.merge(other.call);
+      }
       
     };
     
@@ -488,89 +705,43 @@ namespace Poker {
 
     template <typename T>
     struct PerHoleHandContainer {
-      // Pocket pair hole hands
-      // Indexed AceLow (0) ... King (12)
-      T pocket_pairs[13];
-
-      // Suited non-pairs
-      // Indexed densely
-      T suited[13*12/2];
-
-      // Offsuit non-pairs
-      // Indexed densely
-      T offsuit[13*12/2];
-
-      // rank0 > rank1
-      // rank0, rank1 in [0..13)
-      static constexpr size_t get_non_pair_index(size_t rank0, size_t rank1) {
-	size_t total_size = 13*12/2;
-	size_t rank0_remaining = (rank0+1)*rank0/2;
-	size_t rank0_offset = total_size - rank0_remaining;
-
-	size_t index = rank0_offset + rank1;
-	if(index >= total_size) {
-	  printf("Boooooooooooooooooooooo get_non_pair_index(%zu, %zu) -> %zu limit is %zu\n", rank0, rank1, index, total_size);
-	}
-	
-	return rank0_offset + rank1;
-      }
+      // Indexed by hole card class - see Normal::holdem_hole_class().
+      // Pocket pairs, then suited non-pairs, then offsuit non-pairs.
+      T values[Normal::N_HOLDEM_HOLE_CLASSES];
 
-      
-      // Demote Ace to AceLow
-      inline void normalise_rank(RankT& rank) {
-	rank = to_ace_low(rank);
+      inline T& get_class_value(int hole_class) {
+	return values[hole_class];
       }
 
-      inline T& get_pocket_pair_value(RankT rank) {
-	normalise_rank(rank);
-
-	return pocket_pairs[rank];
+      inline const T& get_class_value(int hole_class) const {
+	return values[hole_class];
       }
 
-      // Demote Ace to AceLow and order rank0, rank1 so that:
-      //   rank0 > rank1
-      //   rank0, rank1 in [0..13)
-      inline void normalise_ranks(RankT& rank0, RankT& rank1) {
-	normalise_rank(rank0);
-	normalise_rank(rank1);
-
-	if(rank0 < rank1) {
-	  RankT tmp = rank0; rank0 = rank1; rank1 = tmp;
-	}
+      inline T& get_pocket_pair_value(RankT rank) {
+	return values[Normal::holdem_hole_class(rank, rank, /*is_suited*/false)];
       }
 
       inline T& get_suited_value(RankT rank0, RankT rank1) {
-	normalise_ranks(rank0, rank1);
-
-	return suited[get_non_pair_index(rank0, rank1)];
+	return values[Normal::holdem_hole_class(rank0, rank1, /*is_suited*/true)];
       }
 	    
       inline T& get_offsuit_value(RankT rank0, RankT rank1) {
-	normalise_ranks(rank0, rank1);
+	return values[Normal::holdem_hole_class(rank0, rank1, /*is_suited*/false)];
+      }
 
-	return offsuit[get_non_pair_index(rank0, rank1)];
+      // Table lookup on the raw cards
+      inline T& get_value(const U8CardT card0, const U8CardT card1) {
+	return values[Normal::holdem_hole_class(card0, card1)];
       }
 	    
       inline T& get_value(const CardT card0, const CardT card1) {
-	// Ensure AceLow - i.e. ranks in [0..13)
-	RankT rank0 = to_ace_low(card0.rank);
-	RankT rank1 = to_ace_low(card1.rank);
-
-	if(rank0 == rank1) {
-	  return pocket_pairs[rank0];
-	}
-
-	// Ensure rank0 >= rank1
-	if(rank0 < rank1) {
-	  RankT tmp = rank0; rank0 = rank1; rank1 = tmp;
-	}
-
-	size_t non_pair_index = get_non_pair_index((size_t)rank0, (size_t)rank1);
+	return values[Normal::holdem_hole_class(card0, card1)];
+      }
 
-	if(card0.suit == card1.suit) {
-	  return suited[non_pair_index];
-	} else {
-	  return offsuit[non_pair_index];
+      // Merge another container's (independent) evaluations into this one - only for eval trees
+      inline void merge(const PerHoleHandContainer<T>& other) {
+	for(std::size_t i = 0; i < Normal::N_HOLDEM_HOLE_CLASSES; i++) {
+	  values[i].merge(other.values[i]);
 	}
       }
     };
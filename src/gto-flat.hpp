@@ -0,0 +1,697 @@
+#ifndef GTO_FLAT
+#define GTO_FLAT
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gto-common.hpp"
+#include "gto-eval.hpp"
+#include "gto-strategy.hpp"
+#include "holdem-equity.hpp"
+#include "normal.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Flattened struct-of-arrays layout of the template game trees.
+    //
+    // Every node of a LimitHandStrategy (or the equivalent LimitHandEval) tree gets a constexpr
+    //   pre-order index - the fold child of a node is at index+1, the call child follows the fold
+    //   subtree and so on. The per-node values then live in dense per-field arrays indexed by
+    //   [node][hole class], so that a traversal for one P0 hole class is index arithmetic over
+    //   vectors of all P1 hole classes rather than a recursion over pointers.
+    // Only the evaluation uses the flat layout - strategies are flattened before each round
+    //   and the evals are unflattened back into the eval trees for adjustment.
+
+    const int N_FLAT_HOLE_CLASSES = (int)Normal::N_HOLDEM_HOLE_CLASSES;
+
+    // Static description of one node
+    template <int N_PLAYERS>
+    struct FlatNodeT {
+      LimitHandNodeType node_type;
+      int player_no;
+      // -1 for the root
+      int parent;
+      // Action of the parent node's player that leads here, or -1 if the parent is an already-folded node
+      int parent_action;
+      // Child index for each StrategyActionT, or -1; the single child of an already-folded node is children[ActionCall]
+      int children[3];
+      // Leaf profits by showdown outcome - P0 wins, tie, P1 wins.
+      // All the same if all but one player folded.
+      NodeEvalPerPlayerProfit<N_PLAYERS> outcome_profits[3];
+    };
+
+    // Storage policies of the flat layout - how strategy probabilities and eval accumulators are held.
+    // The tree nodes themselves stay double - the CFR regrets and strategy sums need the precision,
+    //   and they are only touched once per round, whereas the flat arrays are streamed for every matchup.
+    // Accumulators are converted with a scale that is shared by the whole FlatEvals - see FlatEvals::scale.
+
+    struct DoubleFlatStorage {
+      typedef double prob_t;
+      typedef double accum_t;
+
+      static inline prob_t store_p(double p) { return p; }
+      static inline double load_p(prob_t p) { return p; }
+      static inline accum_t to_accum(double x, double scale) { return x; }
+      static inline double from_accum(accum_t a, double scale) { return a; }
+    };
+
+    // Half the memory and bandwidth - about 7 significant digits
+    struct FloatFlatStorage {
+      typedef float prob_t;
+      typedef float accum_t;
+
+      static inline prob_t store_p(double p) { return (float)p; }
+      static inline double load_p(prob_t p) { return p; }
+      static inline accum_t to_accum(double x, double scale) { return (float)x; }
+      static inline double from_accum(accum_t a, double scale) { return a; }
+    };
+
+    // A quarter of the memory for probabilities, quantised to 1/65535, and 64-bit fixed-point accumulators.
+    // Unlike float accumulators, fixed-point sums don't lose the small contributions late in a long sum.
+    struct FixedFlatStorage {
+      typedef u16 prob_t;
+      typedef i64 accum_t;
+
+      static inline prob_t store_p(double p) { return (u16)(p*65535.0 + 0.5); }
+      static inline double load_p(prob_t p) { return p*(1.0/65535.0); }
+      static inline accum_t to_accum(double x, double scale) { return (i64)std::llrint(x*scale); }
+      static inline double from_accum(accum_t a, double scale) { return (double)a/scale; }
+    };
+
+    // Strategy probabilities by StrategyActionT - raise_p is zero where raising isn't allowed
+    template <int N_NODES, typename StorageT = DoubleFlatStorage>
+    struct FlatStrategies {
+      typename StorageT::prob_t action_p[3][N_NODES][N_FLAT_HOLE_CLASSES];
+    };
+
+    // Evals of each player's hole classes
+    template <int N_PLAYERS, int N_NODES, typename StorageT = DoubleFlatStorage>
+    struct FlatEvals {
+      typename StorageT::accum_t activity[N_PLAYERS][N_NODES][N_FLAT_HOLE_CLASSES];
+      // [eval player][profit player]
+      typename StorageT::accum_t profits[N_PLAYERS][N_PLAYERS][N_NODES][N_FLAT_HOLE_CLASSES];
+      // Accumulator units per chip - chosen for each evaluation from a bound on the totals so that
+      //   fixed-point accumulators use their full range without overflowing
+      double scale;
+    };
+
+    // Full CFR state of one decision node for one hole class, by StrategyActionT - see GtoStrategy.
+    // Raise is zero where raising isn't allowed, and everything is zero at other nodes.
+    struct FlatCfrStateT {
+      double action_p[3];
+      double regrets[3];
+      double strategy_sums[3];
+    };
+
+    template <int N_ACTIONS>
+    inline void flatten_gto_strategy(const GtoStrategy<N_ACTIONS == 3>& strategy, FlatCfrStateT& state) {
+      state = FlatCfrStateT{};
+      state.action_p[ActionFold] = strategy.fold_p;
+      state.action_p[ActionCall] = strategy.call_p;
+      if constexpr(N_ACTIONS == 3) {
+	state.action_p[ActionRaise] = strategy.raise_p;
+      }
+      for(int a = 0; a < N_ACTIONS; a++) {
+	state.regrets[a] = strategy.regrets[a];
+	state.strategy_sums[a] = strategy.strategy_sums[a];
+      }
+    }
+
+    template <int N_ACTIONS>
+    inline void unflatten_gto_strategy(const FlatCfrStateT& state, GtoStrategy<N_ACTIONS == 3>& strategy) {
+      strategy.fold_p = state.action_p[ActionFold];
+      strategy.call_p = state.action_p[ActionCall];
+      if constexpr(N_ACTIONS == 3) {
+	strategy.raise_p = state.action_p[ActionRaise];
+      }
+      for(int a = 0; a < N_ACTIONS; a++) {
+	strategy.regrets[a] = state.regrets[a];
+	strategy.strategy_sums[a] = state.strategy_sums[a];
+      }
+    }
+
+    template <typename NodeT, LimitHandNodeType NODE_TYPE = get_node_type(NodeT::player_no, NodeT::active_bm, NodeT::n_to_call, NodeT::n_raises_left)>
+    struct LimitHandFlatLayout;
+
+    template <typename NodeT>
+    inline void make_flat_node(FlatNodeT<NodeT::n_players>* nodes, int index, int parent, int parent_action, LimitHandNodeType node_type) {
+      FlatNodeT<NodeT::n_players>& node = nodes[index];
+      node = FlatNodeT<NodeT::n_players>{};
+      node.node_type = node_type;
+      node.player_no = NodeT::player_no;
+      node.parent = parent;
+      node.parent_action = parent_action;
+      node.children[ActionFold] = node.children[ActionCall] = node.children[ActionRaise] = -1;
+    }
+
+    // The current player can fold, call or raise
+    template <typename NodeT>
+    struct LimitHandFlatLayout<NodeT, FoldCallRaiseNodeType> {
+      typedef typename NodeT::fold_t fold_t;
+      typedef typename NodeT::call_t call_t;
+      typedef typename NodeT::raise_t raise_t;
+
+      static constexpr int fold_offset = 1;
+      static constexpr int call_offset = fold_offset + LimitHandFlatLayout<fold_t>::n_nodes;
+      static constexpr int raise_offset = call_offset + LimitHandFlatLayout<call_t>::n_nodes;
+      static constexpr int n_nodes = raise_offset + LimitHandFlatLayout<raise_t>::n_nodes;
+
+      static void make_nodes(FlatNodeT<NodeT::n_players>* nodes, int index, int parent, int parent_action) {
+	make_flat_node<NodeT>(nodes, index, parent, parent_action, FoldCallRaiseNodeType);
+	nodes[index].children[ActionFold] = index + fold_offset;
+	nodes[index].children[ActionCall] = index + call_offset;
+	nodes[index].children[ActionRaise] = index + raise_offset;
+	LimitHandFlatLayout<fold_t>::make_nodes(nodes, index + fold_offset, index, ActionFold);
+	LimitHandFlatLayout<call_t>::make_nodes(nodes, index + call_offset, index, ActionCall);
+	LimitHandFlatLayout<raise_t>::make_nodes(nodes, index + raise_offset, index, ActionRaise);
+      }
+
+      template <int N_NODES, typename StorageT>
+      static void flatten_strategy(const NodeT& strategy, int index, int hole_class, FlatStrategies<N_NODES, StorageT>& flat) {
+	flat.action_p[ActionFold][index][hole_class] = StorageT::store_p(strategy.strategy.fold_p);
+	flat.action_p[ActionCall][index][hole_class] = StorageT::store_p(strategy.strategy.call_p);
+	flat.action_p[ActionRaise][index][hole_class] = StorageT::store_p(strategy.strategy.raise_p);
+	LimitHandFlatLayout<fold_t>::flatten_strategy(strategy.fold, index + fold_offset, hole_class, flat);
+	LimitHandFlatLayout<call_t>::flatten_strategy(strategy.call, index + call_offset, hole_class, flat);
+	LimitHandFlatLayout<raise_t>::flatten_strategy(strategy.raise, index + raise_offset, hole_class, flat);
+      }
+
+      // states are the nodes of one hole class
+      static void flatten_cfr_state(const NodeT& strategy, int index, FlatCfrStateT* states) {
+	flatten_gto_strategy<3>(strategy.strategy, states[index]);
+	LimitHandFlatLayout<fold_t>::flatten_cfr_state(strategy.fold, index + fold_offset, states);
+	LimitHandFlatLayout<call_t>::flatten_cfr_state(strategy.call, index + call_offset, states);
+	LimitHandFlatLayout<raise_t>::flatten_cfr_state(strategy.raise, index + raise_offset, states);
+      }
+
+      static void unflatten_cfr_state(const FlatCfrStateT* states, int index, NodeT& strategy) {
+	unflatten_gto_strategy<3>(states[index], strategy.strategy);
+	LimitHandFlatLayout<fold_t>::unflatten_cfr_state(states, index + fold_offset, strategy.fold);
+	LimitHandFlatLayout<call_t>::unflatten_cfr_state(states, index + call_offset, strategy.call);
+	LimitHandFlatLayout<raise_t>::unflatten_cfr_state(states, index + raise_offset, strategy.raise);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void flatten_eval(const EvalT& eval, int player_no, int index, int hole_class, FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat) {
+	flat.activity[player_no][index][hole_class] = StorageT::to_accum(eval.eval.activity, flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  flat.profits[player_no][n][index][hole_class] = StorageT::to_accum(eval.eval.player_profits.profits[n], flat.scale);
+	}
+	LimitHandFlatLayout<fold_t>::flatten_eval(eval.fold, player_no, index + fold_offset, hole_class, flat);
+	LimitHandFlatLayout<call_t>::flatten_eval(eval.call, player_no, index + call_offset, hole_class, flat);
+	LimitHandFlatLayout<raise_t>::flatten_eval(eval.raise, player_no, index + raise_offset, hole_class, flat);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void unflatten_eval(const FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat, int player_no, int index, int hole_class, EvalT& eval) {
+	eval.eval.activity = StorageT::from_accum(flat.activity[player_no][index][hole_class], flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  eval.eval.player_profits.profits[n] = StorageT::from_accum(flat.profits[player_no][n][index][hole_class], flat.scale);
+	}
+	LimitHandFlatLayout<fold_t>::unflatten_eval(flat, player_no, index + fold_offset, hole_class, eval.fold);
+	LimitHandFlatLayout<call_t>::unflatten_eval(flat, player_no, index + call_offset, hole_class, eval.call);
+	LimitHandFlatLayout<raise_t>::unflatten_eval(flat, player_no, index + raise_offset, hole_class, eval.raise);
+      }
+    };
+
+    // The current player can only fold or call
+    template <typename NodeT>
+    struct LimitHandFlatLayout<NodeT, FoldCallNodeType> {
+      typedef typename NodeT::fold_t fold_t;
+      typedef typename NodeT::call_t call_t;
+
+      static constexpr int fold_offset = 1;
+      static constexpr int call_offset = fold_offset + LimitHandFlatLayout<fold_t>::n_nodes;
+      static constexpr int n_nodes = call_offset + LimitHandFlatLayout<call_t>::n_nodes;
+
+      static void make_nodes(FlatNodeT<NodeT::n_players>* nodes, int index, int parent, int parent_action) {
+	make_flat_node<NodeT>(nodes, index, parent, parent_action, FoldCallNodeType);
+	nodes[index].children[ActionFold] = index + fold_offset;
+	nodes[index].children[ActionCall] = index + call_offset;
+	LimitHandFlatLayout<fold_t>::make_nodes(nodes, index + fold_offset, index, ActionFold);
+	LimitHandFlatLayout<call_t>::make_nodes(nodes, index + call_offset, index, ActionCall);
+      }
+
+      template <int N_NODES, typename StorageT>
+      static void flatten_strategy(const NodeT& strategy, int index, int hole_class, FlatStrategies<N_NODES, StorageT>& flat) {
+	flat.action_p[ActionFold][index][hole_class] = StorageT::store_p(strategy.strategy.fold_p);
+	flat.action_p[ActionCall][index][hole_class] = StorageT::store_p(strategy.strategy.call_p);
+	flat.action_p[ActionRaise][index][hole_class] = StorageT::store_p(0.0);
+	LimitHandFlatLayout<fold_t>::flatten_strategy(strategy.fold, index + fold_offset, hole_class, flat);
+	LimitHandFlatLayout<call_t>::flatten_strategy(strategy.call, index + call_offset, hole_class, flat);
+      }
+
+      static void flatten_cfr_state(const NodeT& strategy, int index, FlatCfrStateT* states) {
+	flatten_gto_strategy<2>(strategy.strategy, states[index]);
+	LimitHandFlatLayout<fold_t>::flatten_cfr_state(strategy.fold, index + fold_offset, states);
+	LimitHandFlatLayout<call_t>::flatten_cfr_state(strategy.call, index + call_offset, states);
+      }
+
+      static void unflatten_cfr_state(const FlatCfrStateT* states, int index, NodeT& strategy) {
+	unflatten_gto_strategy<2>(states[index], strategy.strategy);
+	LimitHandFlatLayout<fold_t>::unflatten_cfr_state(states, index + fold_offset, strategy.fold);
+	LimitHandFlatLayout<call_t>::unflatten_cfr_state(states, index + call_offset, strategy.call);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void flatten_eval(const EvalT& eval, int player_no, int index, int hole_class, FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat) {
+	flat.activity[player_no][index][hole_class] = StorageT::to_accum(eval.eval.activity, flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  flat.profits[player_no][n][index][hole_class] = StorageT::to_accum(eval.eval.player_profits.profits[n], flat.scale);
+	}
+	LimitHandFlatLayout<fold_t>::flatten_eval(eval.fold, player_no, index + fold_offset, hole_class, flat);
+	LimitHandFlatLayout<call_t>::flatten_eval(eval.call, player_no, index + call_offset, hole_class, flat);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void unflatten_eval(const FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat, int player_no, int index, int hole_class, EvalT& eval) {
+	eval.eval.activity = StorageT::from_accum(flat.activity[player_no][index][hole_class], flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  eval.eval.player_profits.profits[n] = StorageT::from_accum(flat.profits[player_no][n][index][hole_class], flat.scale);
+	}
+	LimitHandFlatLayout<fold_t>::unflatten_eval(flat, player_no, index + fold_offset, hole_class, eval.fold);
+	LimitHandFlatLayout<call_t>::unflatten_eval(flat, player_no, index + call_offset, hole_class, eval.call);
+      }
+    };
+
+    // Leaf nodes - one player left, or showdown
+    template <typename NodeT, LimitHandNodeType NODE_TYPE>
+    struct LimitHandFlatLeafLayout {
+      static constexpr int n_nodes = 1;
+
+      static void make_nodes(FlatNodeT<NodeT::n_players>* nodes, int index, int parent, int parent_action) {
+	make_flat_node<NodeT>(nodes, index, parent, parent_action, NODE_TYPE);
+	FlatNodeT<NodeT::n_players>& node = nodes[index];
+	if(NODE_TYPE == AllButOneFoldNodeType) {
+	  for(int outcome = 0; outcome < 3; outcome++) {
+	    node.outcome_profits[outcome] = make_player_profits_for_one_winner<NodeT::n_players>(NodeT::active_bm, NodeT::player_pots_u64);
+	  }
+	} else {
+	  node.outcome_profits[0] = make_player_profits_for_winners<NodeT::n_players>(active_bm_u8_mask(0), NodeT::player_pots_u64);
+	  node.outcome_profits[1] = make_player_profits_for_winners<NodeT::n_players>(NodeT::active_bm, NodeT::player_pots_u64);
+	  node.outcome_profits[2] = make_player_profits_for_winners<NodeT::n_players>(active_bm_u8_mask(1), NodeT::player_pots_u64);
+	}
+      }
+
+      template <int N_NODES, typename StorageT>
+      static void flatten_strategy(const NodeT& strategy, int index, int hole_class, FlatStrategies<N_NODES, StorageT>& flat) {
+	for(int action = 0; action < 3; action++) {
+	  flat.action_p[action][index][hole_class] = StorageT::store_p(0.0);
+	}
+      }
+
+      static void flatten_cfr_state(const NodeT& strategy, int index, FlatCfrStateT* states) {
+	states[index] = FlatCfrStateT{};
+      }
+
+      static void unflatten_cfr_state(const FlatCfrStateT* states, int index, NodeT& strategy) {}
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void flatten_eval(const EvalT& eval, int player_no, int index, int hole_class, FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat) {
+	flat.activity[player_no][index][hole_class] = StorageT::to_accum(eval.eval.activity, flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  flat.profits[player_no][n][index][hole_class] = StorageT::to_accum(eval.eval.player_profits.profits[n], flat.scale);
+	}
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void unflatten_eval(const FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat, int player_no, int index, int hole_class, EvalT& eval) {
+	eval.eval.activity = StorageT::from_accum(flat.activity[player_no][index][hole_class], flat.scale);
+	for(int n = 0; n < NodeT::n_players; n++) {
+	  eval.eval.player_profits.profits[n] = StorageT::from_accum(flat.profits[player_no][n][index][hole_class], flat.scale);
+	}
+      }
+    };
+
+    template <typename NodeT>
+    struct LimitHandFlatLayout<NodeT, AllButOneFoldNodeType> : LimitHandFlatLeafLayout<NodeT, AllButOneFoldNodeType> {};
+
+    template <typename NodeT>
+    struct LimitHandFlatLayout<NodeT, ShowdownNodeType> : LimitHandFlatLeafLayout<NodeT, ShowdownNodeType> {};
+
+    // Current player already folded - a pass-through node with no eval of its own
+    template <typename NodeT>
+    struct LimitHandFlatLayout<NodeT, AlreadyFoldedNodeType> {
+      typedef typename NodeT::dead_t dead_t;
+
+      static constexpr int n_nodes = 1 + LimitHandFlatLayout<dead_t>::n_nodes;
+
+      static void make_nodes(FlatNodeT<NodeT::n_players>* nodes, int index, int parent, int parent_action) {
+	make_flat_node<NodeT>(nodes, index, parent, parent_action, AlreadyFoldedNodeType);
+	nodes[index].children[ActionCall] = index + 1;
+	LimitHandFlatLayout<dead_t>::make_nodes(nodes, index + 1, index, /*parent_action*/-1);
+      }
+
+      template <int N_NODES, typename StorageT>
+      static void flatten_strategy(const NodeT& strategy, int index, int hole_class, FlatStrategies<N_NODES, StorageT>& flat) {
+	for(int action = 0; action < 3; action++) {
+	  flat.action_p[action][index][hole_class] = StorageT::store_p(0.0);
+	}
+	LimitHandFlatLayout<dead_t>::flatten_strategy(strategy._, index + 1, hole_class, flat);
+      }
+
+      static void flatten_cfr_state(const NodeT& strategy, int index, FlatCfrStateT* states) {
+	states[index] = FlatCfrStateT{};
+	LimitHandFlatLayout<dead_t>::flatten_cfr_state(strategy._, index + 1, states);
+      }
+
+      static void unflatten_cfr_state(const FlatCfrStateT* states, int index, NodeT& strategy) {
+	LimitHandFlatLayout<dead_t>::unflatten_cfr_state(states, index + 1, strategy._);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void flatten_eval(const EvalT& eval, int player_no, int index, int hole_class, FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat) {
+	LimitHandFlatLayout<dead_t>::flatten_eval(eval._, player_no, index + 1, hole_class, flat);
+      }
+
+      template <typename EvalT, int N_NODES, typename StorageT>
+      static void unflatten_eval(const FlatEvals<NodeT::n_players, N_NODES, StorageT>& flat, int player_no, int index, int hole_class, EvalT& eval) {
+	LimitHandFlatLayout<dead_t>::unflatten_eval(flat, player_no, index + 1, hole_class, eval._);
+      }
+    };
+
+    // The flat layout of a whole tree, and conversion of per-hole-class trees to and from it
+    template <typename RootStrategyT, typename StorageT = DoubleFlatStorage>
+    struct FlatTree {
+      static constexpr int n_players = RootStrategyT::n_players;
+      static constexpr int n_nodes = LimitHandFlatLayout<RootStrategyT>::n_nodes;
+
+      typedef StorageT storage_t;
+      typedef FlatStrategies<n_nodes, StorageT> strategies_t;
+      typedef FlatEvals<n_players, n_nodes, StorageT> evals_t;
+
+      // In pre-order, so parents always precede their children
+      FlatNodeT<n_players> nodes[n_nodes];
+
+      FlatTree() {
+	LimitHandFlatLayout<RootStrategyT>::make_nodes(nodes, /*index*/0, /*parent*/-1, /*parent_action*/-1);
+      }
+
+      void flatten_strategies(const PerHoleHandContainer<RootStrategyT>& hole_hand_strategies, strategies_t& flat) const {
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  LimitHandFlatLayout<RootStrategyT>::flatten_strategy(hole_hand_strategies.get_class_value(hole_class), /*index*/0, hole_class, flat);
+	}
+      }
+
+      // CFR state of every node of every hole class, laid out [hole class][node]
+      void flatten_cfr_states(const PerHoleHandContainer<RootStrategyT>& hole_hand_strategies, std::vector<FlatCfrStateT>& states) const {
+	states.resize((size_t)N_FLAT_HOLE_CLASSES*n_nodes);
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  LimitHandFlatLayout<RootStrategyT>::flatten_cfr_state(hole_hand_strategies.get_class_value(hole_class), /*index*/0, &states[(size_t)hole_class*n_nodes]);
+	}
+      }
+
+      void unflatten_cfr_states(const std::vector<FlatCfrStateT>& states, PerHoleHandContainer<RootStrategyT>& hole_hand_strategies) const {
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  LimitHandFlatLayout<RootStrategyT>::unflatten_cfr_state(&states[(size_t)hole_class*n_nodes], /*index*/0, hole_hand_strategies.get_class_value(hole_class));
+	}
+      }
+
+      // Overwrites player_no's flat evals - leaves flat.scale as is
+      template <typename RootEvalT>
+      void flatten_evals(const PerHoleHandContainer<RootEvalT>& hole_hand_evals, int player_no, evals_t& flat) const {
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  LimitHandFlatLayout<RootStrategyT>::flatten_eval(hole_hand_evals.get_class_value(hole_class), player_no, /*index*/0, hole_class, flat);
+	}
+      }
+
+      // Overwrites player_no's eval trees
+      template <typename RootEvalT>
+      void unflatten_evals(const evals_t& flat, int player_no, PerHoleHandContainer<RootEvalT>& hole_hand_evals) const {
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  LimitHandFlatLayout<RootStrategyT>::unflatten_eval(flat, player_no, /*index*/0, hole_class, hole_hand_evals.get_class_value(hole_class));
+	}
+      }
+    };
+
+    // Heads-up hole class matchups to be evaluated - the weight of each matchup and its showdown
+    //   outcome probabilities, laid out by P1 class so that rows can be read as vectors
+    struct HeadsUpClassMatchupsT {
+      // [p0 class][p1 class]
+      double weight[N_FLAT_HOLE_CLASSES][N_FLAT_HOLE_CLASSES];
+      // [P0 wins/tie/P1 wins][p0 class][p1 class]
+      double outcome_p[3][N_FLAT_HOLE_CLASSES][N_FLAT_HOLE_CLASSES];
+      // Number of deals the outcome probabilities are frequencies over - zero if they are exact
+      double n_samples[N_FLAT_HOLE_CLASSES][N_FLAT_HOLE_CLASSES];
+
+      inline void set_matchup(int p0_class, int p1_class, double matchup_weight, const HeadsUpShowdownEquity& equity, double matchup_n_samples = 0.0) {
+	weight[p0_class][p1_class] = matchup_weight;
+	outcome_p[0][p0_class][p1_class] = equity.p0_win_p;
+	outcome_p[1][p0_class][p1_class] = equity.tie_p;
+	outcome_p[2][p0_class][p1_class] = equity.p1_win_p;
+	n_samples[p0_class][p1_class] = matchup_n_samples;
+      }
+    };
+
+    // All matchups weighted by the number of hole hand pairs, with exact preflop showdown equity
+    inline void make_exact_heads_up_class_matchups(HeadsUpClassMatchupsT& matchups) {
+      for(int p0_class = 0; p0_class < N_FLAT_HOLE_CLASSES; p0_class++) {
+	for(int p1_class = 0; p1_class < N_FLAT_HOLE_CLASSES; p1_class++) {
+	  const Equity::HoldemClassMatchupT& matchup = Equity::holdem_preflop_equity(p0_class, p1_class);
+	  matchups.set_matchup(p0_class, p1_class, (double)matchup.n_combo_pairs(), HeadsUpShowdownEquity{ matchup.p0_win_p(), matchup.tie_p(), matchup.p1_win_p() });
+	}
+      }
+    }
+
+    // Sampling variance of each player's own profit totals in FlatEvals, arising from the matchup
+    //   outcome probabilities being frequencies over a finite number of deals
+    template <int N_NODES>
+    struct HeadsUpFlatProfitVariancesT {
+      // [player][node][hole class] - in the same units as the profit totals, squared
+      double variance[2][N_NODES][N_FLAT_HOLE_CLASSES];
+    };
+
+    // Evaluate every pair of heads-up hole classes, accumulating into flat_evals.
+    // Same results as LimitHandEval::evaluate_hand() with HeadsUpShowdownEquity outcomes and a chance
+    //   probability of the matchup weight, for all matchups, up to floating point summation order.
+    // A node is pruned for a P0 class, as per PlayerReach::is_pruned(), only if it is pruned against
+    //   every P1 class, so that the vectors stay dense; its subtree is then skipped and counts as zero profit.
+    // The evals must be zero on entry since their scale is chosen here.
+    // If variances is non-null it is also accumulated into, for the matchups with sampled outcomes.
+    template <typename RootStrategyT, typename StorageT>
+    void evaluate_heads_up_class_matchups_flat(const FlatTree<RootStrategyT, StorageT>& tree, const typename FlatTree<RootStrategyT, StorageT>::strategies_t& flat_strategies, const HeadsUpClassMatchupsT& matchups, typename FlatTree<RootStrategyT, StorageT>::evals_t& flat_evals, double prune_p = 0.0, HeadsUpFlatProfitVariancesT<FlatTree<RootStrategyT, StorageT>::n_nodes>* variances = nullptr) {
+      static_assert(RootStrategyT::n_players == 2, "flat class matchup evaluation is heads-up only");
+
+      typedef typename StorageT::prob_t prob_t;
+
+      const int N_NODES = FlatTree<RootStrategyT, StorageT>::n_nodes;
+      const int N_CLASSES = N_FLAT_HOLE_CLASSES;
+
+      // Every total is at most the total matchup weight times the largest per-hand profit (or one, for activity),
+      //   which leaves a factor of four of headroom in a signed 64-bit accumulator
+      double max_abs_profit = 1.0;
+      for(int i = 0; i < N_NODES; i++) {
+	for(int outcome = 0; outcome < 3; outcome++) {
+	  for(int n = 0; n < 2; n++) {
+	    max_abs_profit = std::max(max_abs_profit, std::abs(tree.nodes[i].outcome_profits[outcome].profits[n]));
+	  }
+	}
+      }
+      double total_weight = 0.0;
+      for(int p0_class = 0; p0_class < N_CLASSES; p0_class++) {
+	for(int c = 0; c < N_CLASSES; c++) {
+	  total_weight += matchups.weight[p0_class][c];
+	}
+      }
+      flat_evals.scale = total_weight == 0.0 ? 1.0 : std::ldexp(1.0, 61) / (total_weight*max_abs_profit);
+      const double scale = flat_evals.scale;
+
+      // Per-P0-class scratch - on the heap cos this is large-ish
+      struct ScratchT {
+	// P0's reach is the same for all P1 classes
+	double p0_reach[N_NODES];
+	double p1_reach[N_NODES][N_CLASSES];
+	// Per-hand profits of each player
+	double profits[2][N_NODES][N_CLASSES];
+	// Per-hand profits of each player given each showdown outcome - only for variances
+	double outcome_profits[3][2][N_NODES][N_CLASSES];
+	bool is_pruned[N_NODES];
+	// Outcome probabilities of a certain outcome
+	double zero_p[N_CLASSES];
+	double one_p[N_CLASSES];
+      };
+      ScratchT* scratch = new ScratchT();
+      for(int c = 0; c < N_CLASSES; c++) {
+	scratch->zero_p[c] = 0.0;
+	scratch->one_p[c] = 1.0;
+      }
+
+      for(int p0_class = 0; p0_class < N_CLASSES; p0_class++) {
+	const double* weight = matchups.weight[p0_class];
+	const double* p0_win_p = matchups.outcome_p[0][p0_class];
+	const double* tie_p = matchups.outcome_p[1][p0_class];
+	const double* p1_win_p = matchups.outcome_p[2][p0_class];
+
+	// Nothing to do if P0's class was never dealt
+	bool is_dealt = false;
+	for(int c = 0; c < N_CLASSES; c++) {
+	  is_dealt = is_dealt || weight[c] != 0.0;
+	}
+	if(!is_dealt) {
+	  continue;
+	}
+
+	// Reach probabilities, top-down
+	scratch->p0_reach[0] = 1.0;
+	for(int c = 0; c < N_CLASSES; c++) {
+	  scratch->p1_reach[0][c] = 1.0;
+	}
+	scratch->is_pruned[0] = false;
+	for(int i = 1; i < N_NODES; i++) {
+	  const FlatNodeT<2>& node = tree.nodes[i];
+	  const int parent = node.parent;
+
+	  if(scratch->is_pruned[parent]) {
+	    scratch->is_pruned[i] = true;
+	    continue;
+	  }
+	  const int action = node.parent_action;
+	  const bool is_p0_action = action >= 0 && tree.nodes[parent].player_no == 0;
+	  const bool is_p1_action = action >= 0 && tree.nodes[parent].player_no == 1;
+
+	  scratch->p0_reach[i] = is_p0_action ? scratch->p0_reach[parent] * StorageT::load_p(flat_strategies.action_p[action][parent][p0_class]) : scratch->p0_reach[parent];
+	  if(is_p1_action) {
+	    const prob_t* action_p = flat_strategies.action_p[action][parent];
+	    for(int c = 0; c < N_CLASSES; c++) {
+	      scratch->p1_reach[i][c] = scratch->p1_reach[parent][c] * StorageT::load_p(action_p[c]);
+	    }
+	  } else {
+	    for(int c = 0; c < N_CLASSES; c++) {
+	      scratch->p1_reach[i][c] = scratch->p1_reach[parent][c];
+	    }
+	  }
+
+	  bool is_pruned = scratch->p0_reach[i] <= prune_p;
+	  for(int c = 0; c < N_CLASSES; c++) {
+	    is_pruned = is_pruned && (weight[c] == 0.0 || scratch->p1_reach[i][c] <= prune_p);
+	  }
+	  scratch->is_pruned[i] = is_pruned;
+	}
+
+	// Per-hand profits, bottom-up, for the given showdown outcome probabilities
+	auto eval_profits = [&](const double* p0_win_p, const double* tie_p, const double* p1_win_p, double (*all_profits)[N_NODES][N_CLASSES]) {
+	  for(int i = N_NODES-1; i >= 0; i--) {
+	    const FlatNodeT<2>& node = tree.nodes[i];
+	    for(int n = 0; n < 2; n++) {
+	      double* profits = all_profits[n][i];
+
+	      if(scratch->is_pruned[i]) {
+		for(int c = 0; c < N_CLASSES; c++) {
+		  profits[c] = 0.0;
+		}
+	      } else if(node.node_type == AllButOneFoldNodeType) {
+		for(int c = 0; c < N_CLASSES; c++) {
+		  profits[c] = node.outcome_profits[0].profits[n];
+		}
+	      } else if(node.node_type == ShowdownNodeType) {
+		const double p0_wins_profit = node.outcome_profits[0].profits[n];
+		const double tie_profit = node.outcome_profits[1].profits[n];
+		const double p1_wins_profit = node.outcome_profits[2].profits[n];
+		for(int c = 0; c < N_CLASSES; c++) {
+		  profits[c] = p0_win_p[c]*p0_wins_profit + tie_p[c]*tie_profit + p1_win_p[c]*p1_wins_profit;
+		}
+	      } else if(node.node_type == AlreadyFoldedNodeType) {
+		const double* child_profits = all_profits[n][node.children[ActionCall]];
+		for(int c = 0; c < N_CLASSES; c++) {
+		  profits[c] = child_profits[c];
+		}
+	      } else {
+		for(int c = 0; c < N_CLASSES; c++) {
+		  profits[c] = 0.0;
+		}
+		for(int action = 0; action < 3; action++) {
+		  const int child = node.children[action];
+		  if(child < 0) {
+		    continue;
+		  }
+		  const double* child_profits = all_profits[n][child];
+		  const prob_t* action_p = flat_strategies.action_p[action][i];
+		  if(node.player_no == 0) {
+		    const double p = StorageT::load_p(action_p[p0_class]);
+		    for(int c = 0; c < N_CLASSES; c++) {
+		      profits[c] += p*child_profits[c];
+		    }
+		  } else {
+		    for(int c = 0; c < N_CLASSES; c++) {
+		      profits[c] += StorageT::load_p(action_p[c])*child_profits[c];
+		    }
+		  }
+		}
+	      }
+	    }
+	  }
+	};
+	eval_profits(p0_win_p, tie_p, p1_win_p, scratch->profits);
+	if(variances != nullptr) {
+	  eval_profits(scratch->one_p, scratch->zero_p, scratch->zero_p, scratch->outcome_profits[0]);
+	  eval_profits(scratch->zero_p, scratch->one_p, scratch->zero_p, scratch->outcome_profits[1]);
+	  eval_profits(scratch->zero_p, scratch->zero_p, scratch->one_p, scratch->outcome_profits[2]);
+	}
+
+	// Accumulate evals - each player's weighted by its counterfactual reach
+	for(int i = 0; i < N_NODES; i++) {
+	  if(scratch->is_pruned[i]) {
+	    continue;
+	  }
+
+	  double p0_activity = 0.0;
+	  double p0_profits[2] = { 0.0, 0.0 };
+	  const double p0_reach = scratch->p0_reach[i];
+
+	  for(int c = 0; c < N_CLASSES; c++) {
+	    const double p0_cf_reach = weight[c]*scratch->p1_reach[i][c];
+	    const double p1_cf_reach = weight[c]*p0_reach;
+
+	    p0_activity += p0_cf_reach;
+	    flat_evals.activity[1][i][c] += StorageT::to_accum(p1_cf_reach, scale);
+	    for(int n = 0; n < 2; n++) {
+	      p0_profits[n] += p0_cf_reach*scratch->profits[n][i][c];
+	      flat_evals.profits[1][n][i][c] += StorageT::to_accum(p1_cf_reach*scratch->profits[n][i][c], scale);
+	    }
+	  }
+
+	  flat_evals.activity[0][i][p0_class] += StorageT::to_accum(p0_activity, scale);
+	  for(int n = 0; n < 2; n++) {
+	    flat_evals.profits[0][n][i][p0_class] += StorageT::to_accum(p0_profits[n], scale);
+	  }
+
+	  if(variances != nullptr) {
+	    // The outcomes of different matchups are independent, and the outcome frequency of a matchup
+	    //   over n deals has 1/n of the per-deal variance
+	    const double* n_samples = matchups.n_samples[p0_class];
+	    for(int c = 0; c < N_CLASSES; c++) {
+	      if(n_samples[c] == 0.0) {
+		continue;
+	      }
+	      const double outcome_p[3] = { p0_win_p[c], tie_p[c], p1_win_p[c] };
+	      double deal_variance[2];
+	      for(int n = 0; n < 2; n++) {
+		double sq_profit = 0.0;
+		for(int outcome = 0; outcome < 3; outcome++) {
+		  const double profit = scratch->outcome_profits[outcome][n][i][c];
+		  sq_profit += outcome_p[outcome]*profit*profit;
+		}
+		const double profit = scratch->profits[n][i][c];
+		deal_variance[n] = std::max(0.0, sq_profit - profit*profit) / n_samples[c];
+	      }
+	      const double p0_cf_reach = weight[c]*scratch->p1_reach[i][c];
+	      const double p1_cf_reach = weight[c]*p0_reach;
+	      variances->variance[0][i][p0_class] += p0_cf_reach*p0_cf_reach*deal_variance[0];
+	      variances->variance[1][i][c] += p1_cf_reach*p1_cf_reach*deal_variance[1];
+	    }
+	  }
+	}
+      }
+
+      delete scratch;
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_FLAT
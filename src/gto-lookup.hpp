@@ -0,0 +1,148 @@
+#ifndef GTO_LOOKUP
+#define GTO_LOOKUP
+
+#include <string>
+#include <vector>
+
+#include "gto-eval.hpp"
+#include "gto-flat.hpp"
+#include "normal.hpp"
+#include "table-file.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Fast lookup of solved strategies.
+    //
+    // A solved strategy table is a table file (see TableFile) of one row of action probabilities per
+    //   (hole class, node), laid out [hole class][node] so that the nodes of one hand are close together.
+    // A node is identified by its action sequence id - its pre-order index in the flat layout of the tree
+    //   (see LimitHandFlatLayout), which is resolved once from the action history string.
+    // A lookup is then a single indexed load from the mapped table.
+
+    // Bump when the row layout or the flat node numbering changes
+    const u32 LIMIT_STRATEGY_TABLE_VERSION = 1;
+
+    // Action probabilities of the acting player - all zero at leaf and already-folded nodes,
+    //   raise_p is zero where raising isn't allowed
+    struct LimitStrategyRowT {
+      float fold_p;
+      float call_p;
+      float raise_p;
+      // Keeps rows 16 bytes
+      float reserved;
+    };
+
+    static_assert(sizeof(LimitStrategyRowT) == 16);
+
+    // Table file name for the tree, e.g. limit-2p-1-2-r3-strategy
+    template <typename RootStrategyT>
+    std::string limit_strategy_table_name() {
+      return std::string("limit-") + std::to_string(RootStrategyT::n_players) + "p-" + std::to_string(RootStrategyT::small_blind) + "-" + std::to_string(RootStrategyT::big_blind) + "-r" + std::to_string(RootStrategyT::n_raises_left) + "-strategy";
+    }
+
+    // Persist solved strategies as a strategy table.
+    // @return true on success
+    template <typename RootStrategyT>
+    bool write_limit_strategy_table(const std::string& path, const PerHoleHandContainer<RootStrategyT>& hole_hand_strategies) {
+      typedef FlatTree<RootStrategyT> FlatTreeT;
+      const int N_NODES = FlatTreeT::n_nodes;
+      const int N_CLASSES = N_FLAT_HOLE_CLASSES;
+
+      // Allocate on the heap cos these are large-ish
+      std::vector<typename FlatTreeT::strategies_t> flat_strategies(1);
+      FlatTreeT flat_tree;
+      flat_tree.flatten_strategies(hole_hand_strategies, flat_strategies[0]);
+
+      std::vector<LimitStrategyRowT> rows(N_CLASSES*N_NODES);
+      for(int hole_class = 0; hole_class < N_CLASSES; hole_class++) {
+	for(int node = 0; node < N_NODES; node++) {
+	  LimitStrategyRowT& row = rows[hole_class*N_NODES + node];
+	  row.fold_p = (float)flat_strategies[0].action_p[ActionFold][node][hole_class];
+	  row.call_p = (float)flat_strategies[0].action_p[ActionCall][node][hole_class];
+	  row.raise_p = (float)flat_strategies[0].action_p[ActionRaise][node][hole_class];
+	  row.reserved = 0.0f;
+	}
+      }
+
+      return TableFile::write_table(path, TableFile::LimitStrategyTable, LIMIT_STRATEGY_TABLE_VERSION, sizeof(LimitStrategyRowT), rows.size(), rows.data());
+    }
+
+    // Query interface over a mapped strategy table
+    template <typename RootStrategyT>
+    struct LimitStrategyLookup {
+      typedef FlatTree<RootStrategyT> FlatTreeT;
+
+      static constexpr int n_players = RootStrategyT::n_players;
+      static constexpr int n_nodes = FlatTreeT::n_nodes;
+      static constexpr int n_rows = N_FLAT_HOLE_CLASSES * n_nodes;
+
+      FlatTreeT flat_tree;
+      // Mapped read-only - nullptr if the table is missing or out of date
+      const LimitStrategyRowT* rows;
+
+      LimitStrategyLookup(const std::string& path) {
+	rows = (const LimitStrategyRowT*)TableFile::map_table(path, TableFile::LimitStrategyTable, LIMIT_STRATEGY_TABLE_VERSION, sizeof(LimitStrategyRowT), n_rows);
+      }
+
+      ~LimitStrategyLookup() {
+	if(rows != nullptr) {
+	  TableFile::unmap_table(rows, sizeof(LimitStrategyRowT), n_rows);
+	}
+      }
+
+      LimitStrategyLookup(const LimitStrategyLookup&) = delete;
+      LimitStrategyLookup& operator=(const LimitStrategyLookup&) = delete;
+
+      inline bool is_loaded() const { return rows != nullptr; }
+
+      // Resolve an action history from the root - one of 'f', 'c' or 'r' per action, in order of play,
+      //   e.g. "rc" is SB raise, BB call heads-up. Players who already folded are skipped.
+      // @return the action sequence id, or -1 if the history isn't a path in the tree
+      int action_sequence_id(const char* actions) const {
+	int node = 0;
+	for(const char* action = actions; ; action++) {
+	  // Pass through players that already folded
+	  while(flat_tree.nodes[node].node_type == AlreadyFoldedNodeType) {
+	    node = flat_tree.nodes[node].children[ActionCall];
+	  }
+	  if(*action == '\0') {
+	    return node;
+	  }
+
+	  const int action_no = *action == 'f' ? ActionFold : *action == 'c' ? ActionCall : *action == 'r' ? ActionRaise : -1;
+	  if(action_no < 0 || flat_tree.nodes[node].children[action_no] < 0) {
+	    return -1;
+	  }
+	  node = flat_tree.nodes[node].children[action_no];
+	}
+      }
+
+      // The player to act at the node - the seat the strategy row applies to
+      inline int player_no(int action_sequence_id) const {
+	return flat_tree.nodes[action_sequence_id].player_no;
+      }
+
+      inline const LimitStrategyRowT& lookup(int hole_class, int action_sequence_id) const {
+	return rows[hole_class*n_nodes + action_sequence_id];
+      }
+
+      inline const LimitStrategyRowT& lookup(U8CardT card0, U8CardT card1, int action_sequence_id) const {
+	return lookup(Normal::holdem_hole_class(card0, card1), action_sequence_id);
+      }
+
+      // Batch query - out[i] is the row of hole_classes[i] at action_sequence_ids[i]
+      void lookup_batch(int n_queries, const int* hole_classes, const int* action_sequence_ids, LimitStrategyRowT* out) const {
+	for(int i = 0; i < n_queries; i++) {
+	  out[i] = rows[hole_classes[i]*n_nodes + action_sequence_ids[i]];
+	}
+      }
+    };
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_LOOKUP
@@ -0,0 +1,122 @@
+#ifndef GTO_METRICS
+#define GTO_METRICS
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Per-round solver telemetry - where the time goes, how much of the tree is covered, and how
+    //   much the strategies still move - written as one JSON object per line per round.
+
+    enum SolverPhaseT { DealPhase, EvalPhase, TraversePhase, ReducePhase, AdjustPhase, ExploitabilityPhase, N_SOLVER_PHASES };
+
+    static const char* SOLVER_PHASE_NAMES[N_SOLVER_PHASES] = { "deal", "eval", "traverse", "reduce", "adjust", "exploitability" };
+
+    inline double get_wall_secs() {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline double get_cpu_secs(clockid_t clock_id) {
+      struct timespec ts;
+      clock_gettime(clock_id, &ts);
+      return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+    }
+
+    // Wall and CPU seconds per phase.
+    // Phases that run in parallel shards are timed on each shard's thread and summed over the shards,
+    //   so they are thread-seconds - they only add up to the round's wall time with a single thread.
+    struct SolverPhaseTimesT {
+      double wall_secs[N_SOLVER_PHASES];
+      double cpu_secs[N_SOLVER_PHASES];
+
+      inline void merge(const SolverPhaseTimesT& other) {
+	for(int phase = 0; phase < N_SOLVER_PHASES; phase++) {
+	  wall_secs[phase] += other.wall_secs[phase];
+	  cpu_secs[phase] += other.cpu_secs[phase];
+	}
+      }
+    };
+
+    // Times consecutive phases - each lap() charges the time since the previous lap to a phase
+    struct SolverPhaseTimer {
+      // CLOCK_THREAD_CPUTIME_ID in worker threads, CLOCK_PROCESS_CPUTIME_ID to include all threads
+      clockid_t cpu_clock_id;
+      double wall_secs;
+      double cpu_secs;
+
+      SolverPhaseTimer(clockid_t cpu_clock_id = CLOCK_THREAD_CPUTIME_ID):
+	cpu_clock_id(cpu_clock_id), wall_secs(get_wall_secs()), cpu_secs(get_cpu_secs(cpu_clock_id)) {}
+
+      inline void lap(SolverPhaseTimesT& times, SolverPhaseT phase) {
+	const double now_wall_secs = get_wall_secs();
+	const double now_cpu_secs = get_cpu_secs(cpu_clock_id);
+	times.wall_secs[phase] += now_wall_secs - wall_secs;
+	times.cpu_secs[phase] += now_cpu_secs - cpu_secs;
+	wall_secs = now_wall_secs;
+	cpu_secs = now_cpu_secs;
+      }
+    };
+
+    // Resident memory now
+    inline double get_rss_mb() {
+      long n_pages = 0, n_resident_pages = 0;
+      FILE* statm = fopen("/proc/self/statm", "r");
+      if(statm != nullptr) {
+	if(fscanf(statm, "%ld %ld", &n_pages, &n_resident_pages) != 2) {
+	  n_resident_pages = 0;
+	}
+	fclose(statm);
+      }
+      return (double)n_resident_pages*(double)sysconf(_SC_PAGESIZE)/(1024.0*1024.0);
+    }
+
+    // Peak resident memory so far
+    inline double get_max_rss_mb() {
+      struct rusage usage;
+      getrusage(RUSAGE_SELF, &usage);
+      return (double)usage.ru_maxrss/1024.0;
+    }
+
+    struct SolverRoundMetricsT {
+      int round;
+      // Zero for exact evaluation
+      int n_deals;
+      double wall_secs;
+      double cpu_secs;
+      SolverPhaseTimesT phase_times;
+      // Decision nodes per hole class that the acting player's counterfactual activity never reached this round
+      int n_zero_activity_decisions;
+      int n_decisions;
+      // L1 distance between the strategies of each decision node and hole class before and after the adjustment
+      double max_strategy_l1_delta;
+      double mean_strategy_l1_delta;
+      double exploitability;
+      double rss_mb;
+      double max_rss_mb;
+
+      inline double deals_per_sec() const { return wall_secs > 0.0 ? n_deals/wall_secs : 0.0; }
+    };
+
+    inline void write_solver_round_metrics_json(FILE* file, const SolverRoundMetricsT& metrics) {
+      fprintf(file, "{\"round\":%d,\"n_deals\":%d,\"wall_secs\":%.6f,\"cpu_secs\":%.6f,\"deals_per_sec\":%.1f,\"phases\":{",
+	      metrics.round, metrics.n_deals, metrics.wall_secs, metrics.cpu_secs, metrics.deals_per_sec());
+      for(int phase = 0; phase < N_SOLVER_PHASES; phase++) {
+	fprintf(file, "%s\"%s\":{\"wall_secs\":%.6f,\"cpu_secs\":%.6f}", (phase == 0 ? "" : ","), SOLVER_PHASE_NAMES[phase], metrics.phase_times.wall_secs[phase], metrics.phase_times.cpu_secs[phase]);
+      }
+      fprintf(file, "},\"n_zero_activity_decisions\":%d,\"n_decisions\":%d,\"max_strategy_l1_delta\":%.9f,\"mean_strategy_l1_delta\":%.9f,\"exploitability\":%.9f,\"rss_mb\":%.1f,\"max_rss_mb\":%.1f}\n",
+	      metrics.n_zero_activity_decisions, metrics.n_decisions, metrics.max_strategy_l1_delta, metrics.mean_strategy_l1_delta, metrics.exploitability, metrics.rss_mb, metrics.max_rss_mb);
+      fflush(file);
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_METRICS
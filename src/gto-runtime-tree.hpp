@@ -0,0 +1,586 @@
+#ifndef GTO_RUNTIME_TREE
+#define GTO_RUNTIME_TREE
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "flop-category.hpp"
+#include "gto-common.hpp"
+#include "gto-deal-clumps.hpp"
+#include "gto-strategy.hpp"
+#include "hand-eval.hpp"
+#include "normal.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Limit hold-em game trees built at runtime.
+    //
+    // The template trees (see gto-eval.hpp) carry the game state of every node in its type, so the
+    //   compiler instantiates - and the binary carries - one type per node. That's fine heads-up but
+    //   it explodes with the number of players and raises.
+    // The runtime tree has exactly the same nodes, with the same node types (see get_node_type()) and
+    //   the same fold/call/raise transitions, stored in pre-order in a single arena. Node numbering is
+    //   the same as the flat layout of the template tree (see LimitHandFlatLayout).
+    // Pots are a byte per player like the packed PLAYER_POTS of the template trees, but unpacked, so the
+    //   table isn't limited to the 8 players that fit in a u64.
+    //
+    // Strategies and evals are held per (hole class, decision node) - a decision node is a fold/call[/raise]
+    //   node - and driven by external-sampling MCCFR with the same CFR update as the template trees.
+    // Their storage type is a policy - see DoubleRuntimeStorage - since they dominate the memory of
+    //   multi-player trees.
+    //
+    // Optionally the tree continues to a flop betting round. Every preflop showdown - everyone still in
+    //   has called - becomes a flop deal node followed by a flop betting round with the same node semantics,
+    //   with bets of a big blind and the first active player from the small blind acting first - except
+    //   heads-up, where the big blind acts first on the flop.
+    // The flop isn't dealt into the tree. Instead flop decisions are held per (flop category, decision node),
+    //   so each category plays its own betting subtree - see FlopCategory. Leaves after the flop are
+    //   evaluated on the dealt turn and river, so MCCFR samples them.
+    // Alternatively the flop categories under each flop deal node are clumped adaptively - see DealClumpsT -
+    //   and flop decisions are held per (clump, decision node).
+
+    const int LIMIT_RUNTIME_MAX_PLAYERS = 9;
+
+    enum LimitRuntimeStreetT { PreflopStreet, FlopStreet };
+
+    struct LimitRuntimeNodeT {
+      // LimitHandNodeType
+      u8 node_type;
+      u8 player_no;
+      u16 active_bm;
+      u8 n_to_call;
+      u8 n_raises_left;
+      // LimitRuntimeStreetT
+      u8 street;
+      u8 player_pots[LIMIT_RUNTIME_MAX_PLAYERS];
+      // -1 for the root
+      int parent;
+      // Action of the parent node's player that leads here, or -1 if the parent is an already-folded node
+      int parent_action;
+      // Index of the strategy and eval state of fold/call[/raise] nodes, otherwise -1
+      int decision_no;
+      // Index of the clump state of deal nodes, otherwise -1
+      int deal_no;
+      // Child index for each StrategyActionT, or -1; the single child of an already-folded or flop deal node is children[ActionCall]
+      int children[3];
+
+      inline LimitHandNodeType get_node_type() const { return (LimitHandNodeType)node_type; }
+
+      inline bool is_decision() const { return decision_no >= 0; }
+
+      inline int n_actions() const { return node_type == FoldCallRaiseNodeType ? 3 : 2; }
+    };
+
+    struct LimitRuntimeTreeT {
+      int n_players;
+      int small_blind;
+      int big_blind;
+      // At the root
+      int n_raises;
+      // Is there a flop betting round, and how many raises it allows
+      bool has_flop;
+      int n_flop_raises;
+      // Flop categories, or the max clumps per flop deal node if they're clumped
+      int n_flop_classes;
+      int n_decisions;
+      int n_deals;
+      std::vector<LimitRuntimeNodeT> nodes;
+
+      inline int n_nodes() const { return (int)nodes.size(); }
+
+      // Hole classes preflop, flop categories or clumps on the flop
+      inline int n_street_classes(int street) const {
+	return street == PreflopStreet ? (int)Normal::N_HOLDEM_HOLE_CLASSES : n_flop_classes;
+      }
+
+      // Of the per-class strategies and evals
+      inline int n_classes() const {
+	return has_flop ? std::max(n_street_classes(PreflopStreet), n_street_classes(FlopStreet)) : n_street_classes(PreflopStreet);
+      }
+    };
+
+    inline int get_runtime_curr_max_bet(int n_players, const u8 player_pots[LIMIT_RUNTIME_MAX_PLAYERS]) {
+      int curr_max_bet = -1;
+      for(int n = 0; n < n_players; n++) {
+	curr_max_bet = std::max(curr_max_bet, (int)player_pots[n]);
+      }
+      return curr_max_bet;
+    }
+
+    // Add the sub-tree at a node - same transitions as LimitHandEvalFoldChild, LimitHandEvalCallChild,
+    //   LimitHandEvalRaiseChild and the dead child of already-folded nodes.
+    // @return the index of the node
+    inline int add_limit_runtime_node(LimitRuntimeTreeT& tree, int street, int parent, int parent_action, int player_no, u16 active_bm, int n_to_call, int n_raises_left, const u8 player_pots[LIMIT_RUNTIME_MAX_PLAYERS]) {
+      const int index = tree.n_nodes();
+      LimitHandNodeType node_type = get_node_type(player_no, active_bm, n_to_call, n_raises_left);
+      if(node_type == ShowdownNodeType && street == PreflopStreet && tree.has_flop) {
+	node_type = FlopDealNodeType;
+      }
+
+      LimitRuntimeNodeT node = {};
+      node.node_type = (u8)node_type;
+      node.player_no = (u8)player_no;
+      node.active_bm = active_bm;
+      node.n_to_call = (u8)n_to_call;
+      node.n_raises_left = (u8)n_raises_left;
+      node.street = (u8)street;
+      std::copy(player_pots, player_pots + LIMIT_RUNTIME_MAX_PLAYERS, node.player_pots);
+      node.parent = parent;
+      node.parent_action = parent_action;
+      node.decision_no = (node_type == FoldCallRaiseNodeType || node_type == FoldCallNodeType) ? tree.n_decisions++ : -1;
+      node.deal_no = node_type == FlopDealNodeType ? tree.n_deals++ : -1;
+      node.children[ActionFold] = node.children[ActionCall] = node.children[ActionRaise] = -1;
+      tree.nodes.push_back(node);
+
+      const int next_player_no = next_player(player_no, tree.n_players);
+
+      if(node_type == AlreadyFoldedNodeType) {
+	const int dead = add_limit_runtime_node(tree, street, index, -1, next_player_no, active_bm, n_to_call, n_raises_left, player_pots);
+	tree.nodes[index].children[ActionCall] = dead;
+      }
+
+      // Everyone still in acts at least once on the flop.
+      // In heads-up, BB starts post-flop - otherwise SB.
+      if(node_type == FlopDealNodeType) {
+	const int flop_player_no = tree.n_players == 2 ? 1 : 0;
+	const int flop = add_limit_runtime_node(tree, FlopStreet, index, -1, flop_player_no, active_bm, get_n_active(active_bm), tree.n_flop_raises, player_pots);
+	tree.nodes[index].children[ActionCall] = flop;
+      }
+
+      if(node_type == FoldCallRaiseNodeType || node_type == FoldCallNodeType) {
+	const int curr_max_bet = get_runtime_curr_max_bet(tree.n_players, player_pots);
+
+	const int fold = add_limit_runtime_node(tree, street, index, ActionFold, next_player_no, (u16)(active_bm & ~(1 << player_no)), n_to_call-1, n_raises_left, player_pots);
+	tree.nodes[index].children[ActionFold] = fold;
+
+	u8 call_pots[LIMIT_RUNTIME_MAX_PLAYERS];
+	std::copy(player_pots, player_pots + LIMIT_RUNTIME_MAX_PLAYERS, call_pots);
+	call_pots[player_no] = (u8)curr_max_bet;
+	const int call = add_limit_runtime_node(tree, street, index, ActionCall, next_player_no, active_bm, n_to_call-1, n_raises_left, call_pots);
+	tree.nodes[index].children[ActionCall] = call;
+
+	if(node_type == FoldCallRaiseNodeType) {
+	  u8 raise_pots[LIMIT_RUNTIME_MAX_PLAYERS];
+	  std::copy(player_pots, player_pots + LIMIT_RUNTIME_MAX_PLAYERS, raise_pots);
+	  raise_pots[player_no] = (u8)(curr_max_bet + tree.big_blind);
+	  // Since we raised, we go all the way round the table again...
+	  const int raise = add_limit_runtime_node(tree, street, index, ActionRaise, next_player_no, active_bm, get_n_active(active_bm)-1, n_raises_left-1, raise_pots);
+	  tree.nodes[index].children[ActionRaise] = raise;
+	}
+      }
+
+      return index;
+    }
+
+    // Build the preflop tree - same root as LimitRootHandEval - optionally with a flop betting round.
+    // @param max_flop_clumps is the max clumps per flop deal node, or 0 to play every flop category
+    inline LimitRuntimeTreeT make_limit_runtime_tree(int n_players, int n_raises = 3, int small_blind = 1, int big_blind = 2, bool has_flop = false, int n_flop_raises = 3, int max_flop_clumps = 0) {
+      LimitRuntimeTreeT tree = {};
+      tree.n_players = n_players;
+      tree.small_blind = small_blind;
+      tree.big_blind = big_blind;
+      tree.n_raises = n_raises;
+      tree.has_flop = has_flop;
+      tree.n_flop_raises = n_flop_raises;
+      tree.n_flop_classes = max_flop_clumps > 0 ? max_flop_clumps : FlopCategory::N_FLOP_CATEGORIES;
+
+      u8 root_pots[LIMIT_RUNTIME_MAX_PLAYERS] = {};
+      root_pots[0] = (u8)small_blind;
+      root_pots[1] = (u8)big_blind;
+
+      // Note BB is allowed to still raise
+      add_limit_runtime_node(tree, PreflopStreet, /*parent*/-1, /*parent_action*/-1, /*player_no*/2 % n_players, (u16)((1 << n_players) - 1), /*n_to_call*/n_players, n_raises, root_pots);
+
+      return tree;
+    }
+
+    // Profit of one player at a leaf node - see make_player_profits_for_winners()
+    inline double get_limit_runtime_leaf_profit(const LimitRuntimeTreeT& tree, const LimitRuntimeNodeT& node, int player_no, const HandEval::HandEvalT hand_evals[]) {
+      u16 winners_bm = node.active_bm;
+
+      // Best active hand(s) win at showdown
+      if(node.node_type == ShowdownNodeType) {
+	bool have_active = false;
+	HandEval::HandEvalT winners_eval;
+	for(int n = 0; n < tree.n_players; n++) {
+	  if(!get_is_active(n, node.active_bm)) {
+	    continue;
+	  }
+	  if(!have_active || winners_eval < hand_evals[n]) {
+	    have_active = true;
+	    winners_bm = (u16)(1 << n);
+	    winners_eval = hand_evals[n];
+	  } else if(hand_evals[n] == winners_eval) {
+	    winners_bm |= (u16)(1 << n);
+	  }
+	}
+      }
+
+      if(!get_is_active(player_no, winners_bm)) {
+	return (double) -node.player_pots[player_no];
+      }
+
+      int total_pot = 0;
+      int winners_total_pot = 0;
+      for(int n = 0; n < tree.n_players; n++) {
+	total_pot += node.player_pots[n];
+	if(get_is_active(n, winners_bm)) {
+	  winners_total_pot += node.player_pots[n];
+	}
+      }
+
+      return (double)(total_pot - winners_total_pot) / (double)get_n_active(winners_bm);
+    }
+
+    // What the players know, and the showdown, of one dealt hand
+    struct LimitRuntimeDealT {
+      int hole_classes[LIMIT_RUNTIME_MAX_PLAYERS];
+      // Only with a flop stage - replaced by their clumps below a clumped flop deal node
+      int flop_categories[LIMIT_RUNTIME_MAX_PLAYERS];
+      HandEval::HandEvalT hand_evals[LIMIT_RUNTIME_MAX_PLAYERS];
+
+      // Index of the player's strategy and evals at a node
+      inline int get_class(const LimitRuntimeNodeT& node, int player_no) const {
+	return node.street == PreflopStreet ? hole_classes[player_no] : flop_categories[player_no];
+      }
+    };
+
+    // Storage policies of the per information set strategies and evals - like the flat storage policies
+    //   of gto-flat.hpp, but these persist across rounds and are per (class, decision node) of every player.
+    // The CFR adjustment itself is always in double - see adjust_limit_runtime_strategies().
+    // Eval accumulators are converted with a scale that is shared by the whole LimitRuntimeEvalsT and
+    //   chosen afresh every round - see reset_limit_runtime_evals().
+
+    struct DoubleRuntimeStorage {
+      typedef double prob_t;
+      typedef double cfr_t;
+      typedef double accum_t;
+
+      static inline prob_t store_p(double p) { return p; }
+      static inline double load_p(prob_t p) { return p; }
+      static inline accum_t to_accum(double x, double scale) { return x; }
+      static inline double from_accum(accum_t a, double scale) { return a; }
+    };
+
+    // Half the memory - about 7 significant digits.
+    // Regrets and strategy sums are fine in float - DCFR discounts them every round, and the average
+    //   strategy only needs their ratios.
+    struct FloatRuntimeStorage {
+      typedef float prob_t;
+      typedef float cfr_t;
+      typedef float accum_t;
+
+      static inline prob_t store_p(double p) { return (float)p; }
+      static inline double load_p(prob_t p) { return p; }
+      static inline accum_t to_accum(double x, double scale) { return (float)x; }
+      static inline double from_accum(accum_t a, double scale) { return a; }
+    };
+
+    // Probabilities quantised to 1/65535 and 32-bit fixed-point eval accumulators - about 45% of double.
+    // Unlike float accumulators, fixed-point sums don't lose the small contributions late in a round.
+    struct FixedRuntimeStorage {
+      typedef u16 prob_t;
+      typedef float cfr_t;
+      typedef i32 accum_t;
+
+      static inline prob_t store_p(double p) { return (u16)(p*65535.0 + 0.5); }
+      static inline double load_p(prob_t p) { return p*(1.0/65535.0); }
+      static inline accum_t to_accum(double x, double scale) { return (i32)std::lrint(x*scale); }
+      static inline double from_accum(accum_t a, double scale) { return (double)a/scale; }
+    };
+
+    // CFR state of one decision node for one hole class - see cfr_adjust_strategy().
+    // Fold/call nodes leave the raise slot at 0.0.
+    template <typename StorageT>
+    struct LimitRuntimeStrategyT {
+      typename StorageT::prob_t action_p[3];
+      typename StorageT::cfr_t regrets[3];
+      typename StorageT::cfr_t strategy_sums[3];
+
+      inline double get_p(int action) const { return StorageT::load_p(action_p[action]); }
+    };
+
+    // Counterfactual evals of one decision node for one hole class of the acting player.
+    // Relative action values are profits[action]/activity.
+    template <typename StorageT>
+    struct LimitRuntimeEvalT {
+      typename StorageT::accum_t activity;
+      typename StorageT::accum_t profits[3];
+    };
+
+    // Per (hole class, decision node) state, hole class major so that the nodes of one hand are close together.
+    // Flop decisions are indexed by flop category or clump instead of hole class.
+    template <typename T>
+    struct LimitRuntimeHoleClassArrayT {
+      int n_decisions;
+      std::vector<T> elems;
+
+      LimitRuntimeHoleClassArrayT(const LimitRuntimeTreeT& tree):
+	n_decisions(tree.n_decisions), elems((size_t)tree.n_classes() * tree.n_decisions) {}
+
+      inline T& get(int hole_class, int decision_no) { return elems[(size_t)hole_class*n_decisions + decision_no]; }
+      inline const T& get(int hole_class, int decision_no) const { return elems[(size_t)hole_class*n_decisions + decision_no]; }
+    };
+
+    template <typename StorageT>
+    using LimitRuntimeStrategiesT = LimitRuntimeHoleClassArrayT<LimitRuntimeStrategyT<StorageT>>;
+
+    template <typename StorageT>
+    struct LimitRuntimeEvalsT : LimitRuntimeHoleClassArrayT<LimitRuntimeEvalT<StorageT>> {
+      // Accumulator units per chip - chosen for each round so that fixed-point accumulators use their full
+      //   range without overflowing
+      double scale;
+
+      LimitRuntimeEvalsT(const LimitRuntimeTreeT& tree):
+	LimitRuntimeHoleClassArrayT<LimitRuntimeEvalT<StorageT>>(tree), scale(1.0) {}
+    };
+
+    // Uniform initial strategies, like GtoStrategy
+    template <typename StorageT>
+    inline void init_limit_runtime_strategies(const LimitRuntimeTreeT& tree, LimitRuntimeStrategiesT<StorageT>& strategies) {
+      for(int hole_class = 0; hole_class < tree.n_classes(); hole_class++) {
+	for(const LimitRuntimeNodeT& node : tree.nodes) {
+	  if(!node.is_decision() || hole_class >= tree.n_street_classes(node.street)) {
+	    continue;
+	  }
+	  LimitRuntimeStrategyT<StorageT>& strategy = strategies.get(hole_class, node.decision_no);
+	  strategy = LimitRuntimeStrategyT<StorageT>{};
+	  const int n_actions = node.n_actions();
+	  for(int a = 0; a < n_actions; a++) {
+	    strategy.action_p[a] = StorageT::store_p(1.0/n_actions);
+	  }
+	}
+      }
+    }
+
+    // Most chips in the pot at any node - a bound on any player's profit
+    inline int get_limit_runtime_max_pot(const LimitRuntimeTreeT& tree) {
+      int max_pot = 0;
+      for(const LimitRuntimeNodeT& node : tree.nodes) {
+	int pot = 0;
+	for(int n = 0; n < tree.n_players; n++) {
+	  pot += node.player_pots[n];
+	}
+	max_pot = std::max(max_pot, pot);
+      }
+      return max_pot;
+    }
+
+    // Zero the evals for a round of n_deals traversals per player.
+    // Each traversal visits an information set at most once, so no accumulator exceeds n_deals times the
+    //   biggest pot.
+    template <typename StorageT>
+    inline void reset_limit_runtime_evals(const LimitRuntimeTreeT& tree, int n_deals, LimitRuntimeEvalsT<StorageT>& evals) {
+      std::fill(evals.elems.begin(), evals.elems.end(), LimitRuntimeEvalT<StorageT>{});
+      const double max_accum = (double)std::numeric_limits<typename StorageT::accum_t>::max();
+      evals.scale = max_accum / ((double)std::max(n_deals, 1) * (double)std::max(get_limit_runtime_max_pot(tree), 1));
+    }
+
+    // Clump state per flop deal node, over the flop categories
+    typedef std::vector<DealClumpsT> LimitRuntimeDealClumpsT;
+
+    inline LimitRuntimeDealClumpsT make_limit_runtime_deal_clumps(const LimitRuntimeTreeT& tree) {
+      return LimitRuntimeDealClumpsT(tree.n_deals, DealClumpsT(FlopCategory::N_FLOP_CATEGORIES, tree.n_flop_classes));
+    }
+
+    // One past the last node of the sub-tree at a node, which is contiguous in pre-order
+    inline int get_limit_runtime_subtree_end(const LimitRuntimeTreeT& tree, int index) {
+      int end = index + 1;
+      for(int child : tree.nodes[index].children) {
+	if(child != -1) {
+	  end = std::max(end, get_limit_runtime_subtree_end(tree, child));
+	}
+      }
+      return end;
+    }
+
+    // External-sampling traversal of one dealt hand from a node - see LimitHandEvalSpecialised::sample_hand().
+    // The traverser explores all of their actions and accumulates their evals; everyone else plays a single
+    //   action sampled from their strategy.
+    // With deal clumps, the traverser's profit below each flop deal node is accumulated to their flop category,
+    //   if they're still in the hand.
+    // @return the traverser's profit
+    template <typename StorageT, typename RngT>
+    double sample_limit_runtime_hand(const LimitRuntimeTreeT& tree, int index, int traverser_no, const LimitRuntimeDealT& deal, const LimitRuntimeStrategiesT<StorageT>& strategies, LimitRuntimeEvalsT<StorageT>& evals, RngT& rng, LimitRuntimeDealClumpsT* deal_clumps = nullptr) {
+      const LimitRuntimeNodeT& node = tree.nodes[index];
+
+      switch(node.get_node_type()) {
+      case AllButOneFoldNodeType:
+      case ShowdownNodeType:
+	return get_limit_runtime_leaf_profit(tree, node, traverser_no, deal.hand_evals);
+
+      case AlreadyFoldedNodeType:
+	return sample_limit_runtime_hand(tree, node.children[ActionCall], traverser_no, deal, strategies, evals, rng, deal_clumps);
+
+      case FlopDealNodeType: {
+	if(deal_clumps == nullptr) {
+	  return sample_limit_runtime_hand(tree, node.children[ActionCall], traverser_no, deal, strategies, evals, rng, deal_clumps);
+	}
+	DealClumpsT& clumps = (*deal_clumps)[node.deal_no];
+	LimitRuntimeDealT clumped_deal = deal;
+	for(int n = 0; n < tree.n_players; n++) {
+	  clumped_deal.flop_categories[n] = clumps.get_clump(deal.flop_categories[n]);
+	}
+	const double profit = sample_limit_runtime_hand(tree, node.children[ActionCall], traverser_no, clumped_deal, strategies, evals, rng, deal_clumps);
+	// A traverser who folded preflop just loses what they put in, whatever the flop
+	if(get_is_active(traverser_no, node.active_bm)) {
+	  clumps.add(deal.flop_categories[traverser_no], profit);
+	}
+	return profit;
+      }
+
+      default:
+	break;
+      }
+
+      const LimitRuntimeStrategyT<StorageT>& strategy = strategies.get(deal.get_class(node, node.player_no), node.decision_no);
+      const double action_ps[3] = { strategy.get_p(ActionFold), strategy.get_p(ActionCall), strategy.get_p(ActionRaise) };
+
+      if(node.player_no != traverser_no) {
+	const int action = node.node_type == FoldCallRaiseNodeType ? sample_action<3>(action_ps, rng) : sample_action<2>(action_ps, rng);
+	return sample_limit_runtime_hand(tree, node.children[action], traverser_no, deal, strategies, evals, rng, deal_clumps);
+      }
+
+      LimitRuntimeEvalT<StorageT>& eval = evals.get(deal.get_class(node, traverser_no), node.decision_no);
+      eval.activity += StorageT::to_accum(1.0, evals.scale);
+
+      double profit = 0.0;
+      const int n_actions = node.n_actions();
+      for(int a = 0; a < n_actions; a++) {
+	const double action_profit = sample_limit_runtime_hand(tree, node.children[a], traverser_no, deal, strategies, evals, rng, deal_clumps);
+	eval.profits[a] += StorageT::to_accum(action_profit, evals.scale);
+	profit += action_ps[a]*action_profit;
+      }
+
+      return profit;
+    }
+
+    // CFR update of every decision node from one round of evals - see cfr_adjust_strategy().
+    // Only the CFR adjust modes are supported.
+    // Flop categories don't recall the hole cards, so own reach probabilities - which only weight the average
+    //   strategy - restart at the flop.
+    // The CFR state is loaded into double, adjusted and stored back in the storage type.
+    template <typename StorageT>
+    inline void adjust_limit_runtime_strategies(const LimitRuntimeTreeT& tree, LimitRuntimeStrategiesT<StorageT>& strategies, const LimitRuntimeEvalsT<StorageT>& evals, const StrategyAdjustPolicyT& policy) {
+      const int n_players = tree.n_players;
+      const int n_nodes = tree.n_nodes();
+      const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+      // Each player's own reach probability at each node, for the current hole class
+      std::vector<double> own_reach_ps((size_t)n_nodes * n_players);
+
+      for(int hole_class = 0; hole_class < tree.n_classes(); hole_class++) {
+	// Nodes are in pre-order so parents are always done before their children.
+	// All reach probabilities are of the strategy played this round, so done before any update.
+	std::fill(own_reach_ps.begin(), own_reach_ps.begin() + n_players, 1.0);
+	for(int index = 1; index < n_nodes; index++) {
+	  const LimitRuntimeNodeT& node = tree.nodes[index];
+	  double* own_reach_p = &own_reach_ps[(size_t)index*n_players];
+	  if(tree.nodes[node.parent].node_type == FlopDealNodeType) {
+	    std::fill(own_reach_p, own_reach_p + n_players, 1.0);
+	    continue;
+	  }
+	  std::copy(&own_reach_ps[(size_t)node.parent*n_players], &own_reach_ps[(size_t)node.parent*n_players] + n_players, own_reach_p);
+	  if(node.parent_action >= 0) {
+	    const LimitRuntimeNodeT& parent = tree.nodes[node.parent];
+	    own_reach_p[parent.player_no] *= strategies.get(hole_class, parent.decision_no).get_p(node.parent_action);
+	  }
+	}
+
+	for(int index = 0; index < n_nodes; index++) {
+	  const LimitRuntimeNodeT& node = tree.nodes[index];
+	  if(!node.is_decision() || hole_class >= tree.n_street_classes(node.street)) {
+	    continue;
+	  }
+
+	  LimitRuntimeStrategyT<StorageT>& strategy = strategies.get(hole_class, node.decision_no);
+	  const LimitRuntimeEvalT<StorageT>& eval = evals.get(hole_class, node.decision_no);
+	  const double own_reach_p = own_reach_ps[(size_t)index*n_players + node.player_no];
+	  const double activity = StorageT::from_accum(eval.activity, evals.scale);
+
+	  double values[3];
+	  double ps[3];
+	  double regrets[3];
+	  double strategy_sums[3];
+	  for(int a = 0; a < 3; a++) {
+	    values[a] = eval.activity == 0 ? NaN : StorageT::from_accum(eval.profits[a], evals.scale)/activity;
+	    ps[a] = strategy.get_p(a);
+	    regrets[a] = strategy.regrets[a];
+	    strategy_sums[a] = strategy.strategy_sums[a];
+	  }
+
+	  if(node.node_type == FoldCallRaiseNodeType) {
+	    cfr_adjust_strategy<3>(values, activity, own_reach_p, ps, regrets, strategy_sums, policy);
+	  } else {
+	    cfr_adjust_strategy<2>(values, activity, own_reach_p, ps, regrets, strategy_sums, policy);
+	  }
+
+	  for(int a = 0; a < 3; a++) {
+	    strategy.action_p[a] = StorageT::store_p(ps[a]);
+	    strategy.regrets[a] = (typename StorageT::cfr_t)regrets[a];
+	    strategy.strategy_sums[a] = (typename StorageT::cfr_t)strategy_sums[a];
+	  }
+	}
+      }
+    }
+
+
+    // Does a class only ever check or fold - never bet, raise or call a bet - at every decision of a sub-tree?
+    template <typename StorageT>
+    inline bool is_limit_runtime_subtree_default(const LimitRuntimeTreeT& tree, const LimitRuntimeStrategiesT<StorageT>& strategies, int index, int end, int the_class) {
+      const double DEFAULT_EPSILON = 0.01;
+      for(int i = index; i < end; i++) {
+	const LimitRuntimeNodeT& node = tree.nodes[i];
+	if(!node.is_decision()) {
+	  continue;
+	}
+	const LimitRuntimeStrategyT<StorageT>& strategy = strategies.get(the_class, node.decision_no);
+	if(strategy.get_p(ActionRaise) > DEFAULT_EPSILON) {
+	  return false;
+	}
+	// Facing a bet, calling isn't checking
+	const bool is_facing_bet = node.player_pots[node.player_no] < get_runtime_curr_max_bet(tree.n_players, node.player_pots);
+	if(is_facing_bet && strategy.get_p(ActionCall) > DEFAULT_EPSILON) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    // Re-bucket and split the clumps of every flop deal node after a round - see adjust_deal_clumps().
+    // The strategy state of a split clump's sub-tree is cloned to the new clump.
+    // @return the number of clumps split
+    template <typename StorageT>
+    inline int adjust_limit_runtime_deal_clumps(const LimitRuntimeTreeT& tree, LimitRuntimeStrategiesT<StorageT>& strategies, LimitRuntimeDealClumpsT& deal_clumps, double split_activity) {
+      int n_splits = 0;
+      for(int index = 0; index < tree.n_nodes(); index++) {
+	const LimitRuntimeNodeT& node = tree.nodes[index];
+	if(node.node_type != FlopDealNodeType) {
+	  continue;
+	}
+	const int subtree = node.children[ActionCall];
+	const int end = get_limit_runtime_subtree_end(tree, subtree);
+
+	auto is_default = [&](int clump) { return is_limit_runtime_subtree_default(tree, strategies, subtree, end, clump); };
+	auto clone = [&](int from_clump, int to_clump) {
+	  for(int i = subtree; i < end; i++) {
+	    if(tree.nodes[i].is_decision()) {
+	      strategies.get(to_clump, tree.nodes[i].decision_no) = strategies.get(from_clump, tree.nodes[i].decision_no);
+	    }
+	  }
+	};
+	n_splits += adjust_deal_clumps(deal_clumps[node.deal_no], split_activity, is_default, clone);
+      }
+      return n_splits;
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_RUNTIME_TREE
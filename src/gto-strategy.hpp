@@ -4,6 +4,7 @@
 #include "gto-common.hpp"
 #include "types.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 namespace Poker {
@@ -45,8 +46,16 @@ namespace Poker {
     };
 
     // Policy for adjusting strategies - either converge slowly, or immediately
-    //   clamp to the "best" strategy.
-    enum StrategyAdjustT { AdjustConverge, AdjustToMax };
+    //   clamp to the "best" strategy, or counterfactual regret minimisation.
+    // The CFR modes play the regret-matched strategy each iteration and accumulate the average
+    //   strategy, which is what converges - AdjustToAverage switches to it at the end.
+    //   AdjustCfrPlus - CFR+: regrets floored at zero, linearly weighted average
+    //   AdjustDcfr    - Discounted CFR with alpha = 1.5, beta = 0, gamma = 2
+    enum StrategyAdjustT { AdjustConverge, AdjustToMax, AdjustCfrPlus, AdjustDcfr, AdjustToAverage };
+
+    constexpr inline bool is_cfr_adjust(StrategyAdjustT adjust) {
+      return adjust == AdjustCfrPlus || adjust == AdjustDcfr || adjust == AdjustToAverage;
+    }
     
     // When aadjusting strategies, how do we treat very small strategy values?
     enum StrategyClampT { NoClamp, ClampToMin, ClampToZero };
@@ -57,6 +66,8 @@ namespace Poker {
       double leeway;
       double min_strategy;
       StrategyClampT strategy_clamp;
+      // CFR iteration number, starting at 1 - only used by the CFR modes
+      int cfr_iteration;
     };
 
     // Clamp a  (small) strategy probability to min_strategy by stealing from the max value
@@ -257,6 +268,79 @@ namespace Poker {
       }
     }
     
+    // Counterfactual regret minimisation update of one information set with N_ACTIONS actions.
+    // @param values are the counterfactual values of each action relative to cf_reach_p, i.e. the
+    //    relative profits of the child evals; NaN if there is no counterfactual reach at all
+    // @param cf_reach_p is the probability of the opponents (and chance) reaching the node
+    // @param own_reach_p is the current player's own probability of reaching the node
+    // @param ps is the current strategy, played this iteration, and is updated to the next iteration's
+    template <int N_ACTIONS>
+    void cfr_adjust_strategy(const double values[N_ACTIONS], double cf_reach_p, double own_reach_p, double ps[N_ACTIONS], double regrets[N_ACTIONS], double strategy_sums[N_ACTIONS], const StrategyAdjustPolicyT& policy) {
+      if(policy.adjust == AdjustToAverage) {
+	double sum = 0.0;
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  sum += strategy_sums[a];
+	}
+	// Never reached - keep the current strategy
+	if(sum == 0.0) {
+	  return;
+	}
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  ps[a] = strategy_sums[a]/sum;
+	}
+	return;
+      }
+
+      const double t = (double)policy.cfr_iteration;
+
+      // Accumulate the average strategy with the strategy that was just played
+      if(policy.adjust == AdjustCfrPlus) {
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  strategy_sums[a] += t*own_reach_p*ps[a];
+	}
+      } else {
+	const double sum_discount = (t/(t+1.0))*(t/(t+1.0));
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  strategy_sums[a] = (strategy_sums[a] + own_reach_p*ps[a])*sum_discount;
+	}
+      }
+
+      // No coverage of this node, so no regrets - leave the strategy as is
+      for(int a = 0; a < N_ACTIONS; a++) {
+	if(std::isnan(values[a])) {
+	  return;
+	}
+      }
+
+      double node_value = 0.0;
+      for(int a = 0; a < N_ACTIONS; a++) {
+	node_value += ps[a]*values[a];
+      }
+
+      if(policy.adjust == AdjustCfrPlus) {
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  regrets[a] = std::max(regrets[a] + cf_reach_p*(values[a] - node_value), 0.0);
+	}
+      } else {
+	const double t_alpha = t*std::sqrt(t);
+	const double pos_discount = t_alpha/(t_alpha + 1.0);
+	const double neg_discount = 0.5;
+	for(int a = 0; a < N_ACTIONS; a++) {
+	  regrets[a] += cf_reach_p*(values[a] - node_value);
+	  regrets[a] *= regrets[a] > 0.0 ? pos_discount : neg_discount;
+	}
+      }
+
+      // Regret matching
+      double pos_regret_sum = 0.0;
+      for(int a = 0; a < N_ACTIONS; a++) {
+	pos_regret_sum += std::max(regrets[a], 0.0);
+      }
+      for(int a = 0; a < N_ACTIONS; a++) {
+	ps[a] = pos_regret_sum > 0.0 ? std::max(regrets[a], 0.0)/pos_regret_sum : 1.0/N_ACTIONS;
+      }
+    }
+    
     // GTO strategy - two variants depending on whether we can raise or not.
     template <bool CAN_RAISE>
     struct GtoStrategy;
@@ -269,9 +353,13 @@ namespace Poker {
       double fold_p;
       double call_p;
       double raise_p;
+
+      // CFR state - cumulative regrets and average strategy sums of fold, call, raise
+      double regrets[3];
+      double strategy_sums[3];
       
       GtoStrategy() :
-	fold_p(1.0/3.0), call_p(1.0/3.0), raise_p(1.0/3.0) {}
+	fold_p(1.0/3.0), call_p(1.0/3.0), raise_p(1.0/3.0), regrets(), strategy_sums() {}
 
       // Adjust strategy according to empirical outcomes - reward the more profitable options and
       //   penalise the less profitable options.
@@ -285,6 +373,19 @@ namespace Poker {
 	  stats.n_max_p_action_changes++;
 	}
       }
+
+      // CFR update - see cfr_adjust_strategy()
+      void adjust_cfr(double fold_value, double call_value, double raise_value, double cf_reach_p, double own_reach_p, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
+	StrategyActionT prev_max_p_action = get_max_p_action(fold_p, call_p, raise_p);
+	const double values[3] = { fold_value, call_value, raise_value };
+	double ps[3] = { fold_p, call_p, raise_p };
+	cfr_adjust_strategy<3>(values, cf_reach_p, own_reach_p, ps, regrets, strategy_sums, policy);
+	fold_p = ps[0]; call_p = ps[1]; raise_p = ps[2];
+	StrategyActionT max_p_action = get_max_p_action(fold_p, call_p, raise_p);
+	if(prev_max_p_action != max_p_action) {
+	  stats.n_max_p_action_changes++;
+	}
+      }
       
     }; // struct GtoStrategy</*CAN_RAISE*/true>
 
@@ -295,9 +396,13 @@ namespace Poker {
     struct GtoStrategy</*CAN_RAISE*/false> {
       double fold_p;
       double call_p;
+
+      // CFR state - cumulative regrets and average strategy sums of fold, call
+      double regrets[2];
+      double strategy_sums[2];
       
       GtoStrategy() :
-	fold_p(1.0/2.0), call_p(1.0/2.0) {}
+	fold_p(1.0/2.0), call_p(1.0/2.0), regrets(), strategy_sums() {}
 
       // Adjust strategy according to empirical outcomes - reward the more profitable options and
       //   penalise the less profitable options.
@@ -311,6 +416,19 @@ namespace Poker {
 	  stats.n_max_p_action_changes++;
 	}
       }
+
+      // CFR update - see cfr_adjust_strategy()
+      void adjust_cfr(double fold_value, double call_value, double cf_reach_p, double own_reach_p, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
+	StrategyActionT prev_max_p_action = get_max_p_action(fold_p, call_p);
+	const double values[2] = { fold_value, call_value };
+	double ps[2] = { fold_p, call_p };
+	cfr_adjust_strategy<2>(values, cf_reach_p, own_reach_p, ps, regrets, strategy_sums, policy);
+	fold_p = ps[0]; call_p = ps[1];
+	StrategyActionT max_p_action = get_max_p_action(fold_p, call_p);
+	if(prev_max_p_action != max_p_action) {
+	  stats.n_max_p_action_changes++;
+	}
+      }
       
     }; // struct GtoStrategy</*CAN_RAISE*/false>
     
@@ -502,23 +620,32 @@ namespace Poker {
       GtoStrategy</*CAN_RAISE*/true> strategy;
 
       template <typename PlayerEvalT>
-      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
+      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerReach<N_PLAYERS>& reach, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
 	const PlayerEvalT& curr_player_eval = player_evals.get_player_eval(PLAYER_NO);
 
 	double rel_fold_profit = curr_player_eval.fold.eval.rel_player_profit(PLAYER_NO);
 	double rel_call_profit = curr_player_eval.call.eval.rel_player_profit(PLAYER_NO);
 	double rel_raise_profit = curr_player_eval.raise.eval.rel_player_profit(PLAYER_NO);
 
-	strategy.adjust(rel_fold_profit, rel_call_profit, rel_raise_profit, policy, stats);
+	// Children are reached with the strategy that was evaluated, i.e. before adjustment
+	const PlayerReach<N_PLAYERS> fold_reach = reach.after_action(PLAYER_NO, strategy.fold_p);
+	const PlayerReach<N_PLAYERS> call_reach = reach.after_action(PLAYER_NO, strategy.call_p);
+	const PlayerReach<N_PLAYERS> raise_reach = reach.after_action(PLAYER_NO, strategy.raise_p);
+
+	if(is_cfr_adjust(policy.adjust)) {
+	  strategy.adjust_cfr(rel_fold_profit, rel_call_profit, rel_raise_profit, curr_player_eval.eval.activity, reach.reach_p[PLAYER_NO], policy, stats);
+	} else {
+	  strategy.adjust(rel_fold_profit, rel_call_profit, rel_raise_profit, policy, stats);
+	}
 
 	auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
-	this->fold.adjust(fold_evals, policy, stats);
+	this->fold.adjust(fold_evals, fold_reach, policy, stats);
 
 	auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
-	this->call.adjust(call_evals, policy, stats);
+	this->call.adjust(call_evals, call_reach, policy, stats);
 
 	auto raise_evals = PlayerEvalsRaiseGetter<N_PLAYERS, PlayerEvalT>::get_raise_evals(player_evals);
-	this->raise.adjust(raise_evals, policy, stats);
+	this->raise.adjust(raise_evals, raise_reach, policy, stats);
       }
     };
     
@@ -541,7 +668,7 @@ namespace Poker {
       static const bool is_leaf = true;
 
       template <typename PlayerEvalT>
-      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) { /*noop*/ }
+      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerReach<N_PLAYERS>& reach, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) { /*noop*/ }
     };
     
     // Specialisation for all active players called.
@@ -562,7 +689,7 @@ namespace Poker {
       static const bool is_leaf = true;
 
       template <typename PlayerEvalT>
-      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) { /*noop*/ }
+      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerReach<N_PLAYERS>& reach, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) { /*noop*/ }
     };
     
     // Specialisation for current player already folded
@@ -596,9 +723,9 @@ namespace Poker {
       dead_t _;
 
       template <typename PlayerEvalT>
-      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
+      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerReach<N_PLAYERS>& reach, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
 	auto dead_evals = PlayerEvalsDeadGetter<N_PLAYERS, PlayerEvalT>::get_dead_evals(player_evals);
-	this->_.adjust(dead_evals, policy, stats);
+	this->_.adjust(dead_evals, reach, policy, stats);
       }
       
     };
@@ -628,19 +755,27 @@ namespace Poker {
 
 
       template <typename PlayerEvalT>
-      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
+      void adjust(PlayerEvals<N_PLAYERS, PlayerEvalT> player_evals, const PlayerReach<N_PLAYERS>& reach, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
 	const PlayerEvalT& curr_player_eval = player_evals.get_player_eval(PLAYER_NO);
 
 	double rel_fold_profit = curr_player_eval.fold.eval.rel_player_profit(PLAYER_NO);
 	double rel_call_profit = curr_player_eval.call.eval.rel_player_profit(PLAYER_NO);
 
-	strategy.adjust(rel_fold_profit, rel_call_profit, policy, stats);
+	// Children are reached with the strategy that was evaluated, i.e. before adjustment
+	const PlayerReach<N_PLAYERS> fold_reach = reach.after_action(PLAYER_NO, strategy.fold_p);
+	const PlayerReach<N_PLAYERS> call_reach = reach.after_action(PLAYER_NO, strategy.call_p);
+
+	if(is_cfr_adjust(policy.adjust)) {
+	  strategy.adjust_cfr(rel_fold_profit, rel_call_profit, curr_player_eval.eval.activity, reach.reach_p[PLAYER_NO], policy, stats);
+	} else {
+	  strategy.adjust(rel_fold_profit, rel_call_profit, policy, stats);
+	}
 
 	auto fold_evals = PlayerEvalsFoldGetter<N_PLAYERS, PlayerEvalT>::get_fold_evals(player_evals);
-	this->fold.adjust(fold_evals, policy, stats);
+	this->fold.adjust(fold_evals, fold_reach, policy, stats);
 
 	auto call_evals = PlayerEvalsCallGetter<N_PLAYERS, PlayerEvalT>::get_call_evals(player_evals);
-	this->call.adjust(call_evals, policy, stats);
+	this->call.adjust(call_evals, call_reach, policy, stats);
       }
     };
     
@@ -0,0 +1,165 @@
+#ifndef GTO_WARM_START
+#define GTO_WARM_START
+
+#include <algorithm>
+#include <vector>
+
+#include "gto-common.hpp"
+#include "gto-flat.hpp"
+#include "gto-strategy.hpp"
+#include "normal.hpp"
+#include "types.hpp"
+
+namespace Poker {
+
+  namespace Gto {
+
+    // Warm start of a solve from the solved strategies of a different tree - more or fewer raises, or
+    //   different blinds.
+    //
+    // Nodes are matched by action sequence - see LimitStrategyLookup::action_sequence_id() - and hole class.
+    // A target decision node whose full action sequence is a decision of the same player in the source
+    //   takes the source node's CFR state. Otherwise it takes the state of the deepest decision of the same
+    //   player along the longest prefix of its action sequence that the source tree has - e.g. facing a 4th
+    //   raise takes the state of facing a 2nd raise from a 3-raise tree. Nodes with no match keep their state.
+    // Only the source's average strategy carries over, as the target's first strategy - regrets and strategy
+    //   sums restart from zero. The source's regrets are against another tree's action values, and carrying
+    //   them (or DCFR's iteration count) over makes the solve slower than a cold start.
+    // Raise probability is dropped where the target can't raise, and zero where only the target can raise.
+
+    // How the source tree maps to the target tree
+    struct LimitWarmStartMatchT {
+      // Source node, or -1 if none
+      int src_node;
+      bool is_exact;
+    };
+
+    struct LimitWarmStartStatsT {
+      int n_decisions;
+      int n_exact;
+      int n_prefix;
+      int n_unmatched;
+    };
+
+    inline bool is_flat_decision_node(LimitHandNodeType node_type) {
+      return node_type == FoldCallRaiseNodeType || node_type == FoldCallNodeType;
+    }
+
+    // Match every decision node of the target flat tree to a source flat tree node - one match per target node
+    template <typename SrcFlatTreeT, typename DstFlatTreeT>
+    std::vector<LimitWarmStartMatchT> get_limit_warm_start_matches(const SrcFlatTreeT& src_tree, const DstFlatTreeT& dst_tree) {
+      std::vector<LimitWarmStartMatchT> matches(DstFlatTreeT::n_nodes, LimitWarmStartMatchT{ -1, false });
+
+      for(int dst_node = 0; dst_node < DstFlatTreeT::n_nodes; dst_node++) {
+	if(!is_flat_decision_node(dst_tree.nodes[dst_node].node_type)) {
+	  continue;
+	}
+	const int player_no = dst_tree.nodes[dst_node].player_no;
+
+	// Action sequence from the root, skipping players that already folded
+	std::vector<int> actions;
+	for(int node = dst_node; dst_tree.nodes[node].parent >= 0; node = dst_tree.nodes[node].parent) {
+	  if(dst_tree.nodes[node].parent_action >= 0) {
+	    actions.push_back(dst_tree.nodes[node].parent_action);
+	  }
+	}
+	std::reverse(actions.begin(), actions.end());
+
+	LimitWarmStartMatchT& match = matches[dst_node];
+	int src_node = 0;
+	for(size_t i = 0; ; i++) {
+	  while(src_tree.nodes[src_node].node_type == AlreadyFoldedNodeType) {
+	    src_node = src_tree.nodes[src_node].children[ActionCall];
+	  }
+	  const bool is_player_decision = is_flat_decision_node(src_tree.nodes[src_node].node_type) && src_tree.nodes[src_node].player_no == player_no;
+	  if(is_player_decision) {
+	    match = LimitWarmStartMatchT{ src_node, /*is_exact*/i == actions.size() };
+	  }
+	  if(i == actions.size() || src_tree.nodes[src_node].children[actions[i]] < 0) {
+	    break;
+	  }
+	  src_node = src_tree.nodes[src_node].children[actions[i]];
+	}
+      }
+
+      return matches;
+    }
+
+    // CFR state of a source node carried over to a target node - the source's average strategy, else its
+    //   current strategy if it has no strategy sums
+    inline void warm_start_cfr_state(const FlatCfrStateT& src, bool src_can_raise, bool dst_can_raise, FlatCfrStateT& dst) {
+      dst = FlatCfrStateT{};
+      const int n_actions = std::min(src_can_raise ? 3 : 2, dst_can_raise ? 3 : 2);
+      double sum_sums = 0.0;
+      for(int a = 0; a < n_actions; a++) {
+	sum_sums += src.strategy_sums[a];
+      }
+      const double* src_p = sum_sums > 0.0 ? src.strategy_sums : src.action_p;
+      double sum_p = 0.0;
+      for(int a = 0; a < n_actions; a++) {
+	sum_p += src_p[a];
+      }
+
+      // Renormalise what's left of the strategy
+      for(int a = 0; a < n_actions; a++) {
+	dst.action_p[a] = sum_p > 0.0 ? src_p[a]/sum_p : 1.0/n_actions;
+      }
+    }
+
+    // Initialise the target tree's strategies from solved source strategies.
+    // The source is typically a mapped checkpoint - see map_limit_strategy_checkpoint().
+    template <typename SrcRootStrategyT, typename DstRootStrategyT>
+    LimitWarmStartStatsT warm_start_limit_strategies(const PerHoleHandContainer<SrcRootStrategyT>& src_strategies, PerHoleHandContainer<DstRootStrategyT>& dst_strategies) {
+      static_assert(SrcRootStrategyT::n_players == DstRootStrategyT::n_players, "warm start needs the same number of players");
+
+      typedef FlatTree<SrcRootStrategyT> SrcFlatTreeT;
+      typedef FlatTree<DstRootStrategyT> DstFlatTreeT;
+
+      // Allocate on the heap cos flat trees carry per-node leaf profits
+      std::vector<SrcFlatTreeT> src_tree(1);
+      std::vector<DstFlatTreeT> dst_tree(1);
+
+      const std::vector<LimitWarmStartMatchT> matches = get_limit_warm_start_matches(src_tree[0], dst_tree[0]);
+
+      std::vector<FlatCfrStateT> src_states;
+      src_tree[0].flatten_cfr_states(src_strategies, src_states);
+      std::vector<FlatCfrStateT> dst_states;
+      dst_tree[0].flatten_cfr_states(dst_strategies, dst_states);
+
+      LimitWarmStartStatsT stats = {};
+      for(int dst_node = 0; dst_node < DstFlatTreeT::n_nodes; dst_node++) {
+	if(!is_flat_decision_node(dst_tree[0].nodes[dst_node].node_type)) {
+	  continue;
+	}
+	stats.n_decisions++;
+
+	const LimitWarmStartMatchT& match = matches[dst_node];
+	if(match.src_node < 0) {
+	  stats.n_unmatched++;
+	  continue;
+	}
+	if(match.is_exact) {
+	  stats.n_exact++;
+	} else {
+	  stats.n_prefix++;
+	}
+
+	const bool src_can_raise = src_tree[0].nodes[match.src_node].node_type == FoldCallRaiseNodeType;
+	const bool dst_can_raise = dst_tree[0].nodes[dst_node].node_type == FoldCallRaiseNodeType;
+	for(int hole_class = 0; hole_class < N_FLAT_HOLE_CLASSES; hole_class++) {
+	  const FlatCfrStateT& src = src_states[(size_t)hole_class*SrcFlatTreeT::n_nodes + match.src_node];
+	  FlatCfrStateT& dst = dst_states[(size_t)hole_class*DstFlatTreeT::n_nodes + dst_node];
+	  warm_start_cfr_state(src, src_can_raise, dst_can_raise, dst);
+	}
+      }
+
+      dst_tree[0].unflatten_cfr_states(dst_states, dst_strategies);
+
+      return stats;
+    }
+
+  } // namespace Gto
+
+} // namespace Poker
+
+#endif //def GTO_WARM_START
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "types.hpp"
+#include "board-enum.hpp"
+#include "hand-eval.hpp"
+#include "holdem-equity.hpp"
+#include "normal.hpp"
+#include "table-file.hpp"
+
+using namespace Poker;
+
+// Bump when the equity matrix generation changes
+static const u32 HOLDEM_PREFLOP_EQUITY_TABLE_VERSION = 1;
+
+static const int N_CLASSES = (int)Normal::N_HOLDEM_HOLE_CLASSES;
+
+// Per-class count rows are padded so that the inner loops vectorise cleanly
+static const int COUNTS_ROW_LEN = 176;
+
+// A hole hand is seen from each of its cards as a partner slot - the partner's rank, plus 13 if offsuit
+static const int N_PARTNER_SLOTS = 26;
+
+static inline int partner_slot(u8 card, u8 partner) {
+  return (partner >> 2) + ((card & 0x3) == (partner & 0x3) ? 0 : 13);
+}
+
+struct HoleComboT {
+  u64 card_bits;
+  HandT hand;
+  u8 cards[2];
+  u8 hole_class;
+  // Partner slot of the other card from cards[i]'s point of view
+  u8 slots[2];
+};
+
+struct HoldemEquityGeneratorT {
+  HoleComboT combos[1326];
+  // Hole class of a card of (aces-low) rank with the given partner slot
+  u8 slot_class[13][N_PARTNER_SLOTS];
+
+  // Showdown counts for boards of a given weight - per-board counts are small enough for u32's
+  //   and the weights are few, so we only multiply out by the weight at the end.
+  struct WeightedCountsT {
+    u64 weight;
+    std::vector<u32> wins;
+    std::vector<u32> ties;
+
+    WeightedCountsT(u64 weight): weight(weight), wins(N_CLASSES*COUNTS_ROW_LEN), ties(N_CLASSES*COUNTS_ROW_LEN) {}
+  };
+  std::vector<WeightedCountsT> weighted_counts;
+
+  // Per-board scratch
+  u64 live_combos[1326];
+  // Disjointness is corrected for per card: counts of hands better than nothing yet visited,
+  //   overall by class and by (card, partner slot)
+  u32 lower[COUNTS_ROW_LEN];
+  u32 lower_by_card[52][N_PARTNER_SLOTS];
+  u32 group[COUNTS_ROW_LEN];
+  u32 group_by_card[52][N_PARTNER_SLOTS];
+
+  HoldemEquityGeneratorT() {
+    int n = 0;
+    for (u8 c0 = 0; c0 < 52; c0++) {
+      for (u8 c1 = c0+1; c1 < 52; c1++) {
+	HoleComboT& combo = combos[n++];
+	combo.card_bits = (u64)1 << c0 | (u64)1 << c1;
+	combo.hand = HandT(HandT(U8CardT(c0)), HandT(U8CardT(c1)));
+	combo.cards[0] = c0;
+	combo.cards[1] = c1;
+	combo.hole_class = (u8)Normal::holdem_hole_class(U8CardT(c0), U8CardT(c1));
+	combo.slots[0] = (u8)partner_slot(c0, c1);
+	combo.slots[1] = (u8)partner_slot(c1, c0);
+      }
+    }
+    assert(n == 1326);
+
+    for (int rank = 0; rank < 13; rank++) {
+      for (int slot = 0; slot < N_PARTNER_SLOTS; slot++) {
+	int partner_rank = slot % 13;
+	bool is_suited = slot < 13;
+	// Suited pairs don't exist - their counts are always zero
+	slot_class[rank][slot] = (is_suited && partner_rank == rank) ? 0 : (u8)Normal::holdem_hole_class((RankT)rank, (RankT)partner_rank, is_suited);
+      }
+    }
+
+    memset(group, 0, sizeof(group));
+    memset(group_by_card, 0, sizeof(group_by_card));
+  }
+
+  WeightedCountsT& get_weighted_counts(u64 weight) {
+    for (auto& counts: weighted_counts) {
+      if (counts.weight == weight) {
+	return counts;
+      }
+    }
+    weighted_counts.emplace_back(weight);
+    return weighted_counts.back();
+  }
+
+  static inline void add_row(u32* row, const u32* counts) {
+    for (int c = 0; c < COUNTS_ROW_LEN; c++) {
+      row[c] += counts[c];
+    }
+  }
+
+  inline void sub_card_counts(u32* row, u8 card, const u32 card_counts[N_PARTNER_SLOTS]) const {
+    const u8* classes = slot_class[card >> 2];
+    for (int slot = 0; slot < N_PARTNER_SLOTS; slot++) {
+      row[classes[slot]] -= card_counts[slot];
+    }
+  }
+
+  void eval_board(const U8CardT* board, u64 weight) {
+    u64 board_bits = 0;
+    HandT board_hand;
+    for (int i = 0; i < BoardEnum::N_BOARD_CARDS; i++) {
+      board_bits |= (u64)1 << board[i].u8_card;
+      board_hand.add(board[i]);
+    }
+
+    // Evaluate all live hole hands and sort them worst first, keyed by hand eval then combo index
+    int n_live = 0;
+    for (int i = 0; i < 1326; i++) {
+      if ((combos[i].card_bits & board_bits) == 0) {
+	u64 hand_eval = HandEval::eval_hand_5_to_9_card_compact_fast1(HandT(board_hand, combos[i].hand));
+	live_combos[n_live++] = hand_eval << 11 | (u64)i;
+      }
+    }
+    std::sort(live_combos, live_combos + n_live);
+
+    WeightedCountsT& counts = get_weighted_counts(weight);
+    u32* wins = counts.wins.data();
+    u32* ties = counts.ties.data();
+
+    memset(lower, 0, sizeof(lower));
+    memset(lower_by_card, 0, sizeof(lower_by_card));
+
+    // Visit groups of equally ranked hands.
+    // A hand beats every strictly lower hand, less those sharing either of its cards - two distinct
+    //   hands share at most one card, so the two card corrections never overlap.
+    for (int i = 0; i < n_live; ) {
+      int j = i+1;
+      while (j < n_live && (live_combos[j] >> 11) == (live_combos[i] >> 11)) {
+	j++;
+      }
+
+      for (int k = i; k < j; k++) {
+	const HoleComboT& combo = combos[live_combos[k] & 0x7ff];
+	u32* row = wins + combo.hole_class*COUNTS_ROW_LEN;
+	add_row(row, lower);
+	sub_card_counts(row, combo.cards[0], lower_by_card[combo.cards[0]]);
+	sub_card_counts(row, combo.cards[1], lower_by_card[combo.cards[1]]);
+      }
+
+      if (j - i > 1) {
+	for (int k = i; k < j; k++) {
+	  const HoleComboT& combo = combos[live_combos[k] & 0x7ff];
+	  group[combo.hole_class]++;
+	  group_by_card[combo.cards[0]][combo.slots[0]]++;
+	  group_by_card[combo.cards[1]][combo.slots[1]]++;
+	}
+
+	for (int k = i; k < j; k++) {
+	  const HoleComboT& combo = combos[live_combos[k] & 0x7ff];
+	  u32* row = ties + combo.hole_class*COUNTS_ROW_LEN;
+	  add_row(row, group);
+	  sub_card_counts(row, combo.cards[0], group_by_card[combo.cards[0]]);
+	  sub_card_counts(row, combo.cards[1], group_by_card[combo.cards[1]]);
+	  // The hand itself was added once and subtracted twice
+	  row[combo.hole_class]++;
+	}
+
+	for (int k = i; k < j; k++) {
+	  const HoleComboT& combo = combos[live_combos[k] & 0x7ff];
+	  group[combo.hole_class] = 0;
+	  group_by_card[combo.cards[0]][combo.slots[0]] = 0;
+	  group_by_card[combo.cards[1]][combo.slots[1]] = 0;
+	}
+      }
+
+      for (int k = i; k < j; k++) {
+	const HoleComboT& combo = combos[live_combos[k] & 0x7ff];
+	lower[combo.hole_class]++;
+	lower_by_card[combo.cards[0]][combo.slots[0]]++;
+	lower_by_card[combo.cards[1]][combo.slots[1]]++;
+      }
+
+      i = j;
+    }
+  }
+
+  void generate(Equity::HoldemClassMatchupT* matchups) {
+    for (std::size_t i = 0; i < Equity::N_HOLDEM_CLASS_MATCHUPS; i++) {
+      matchups[i] = Equity::HoldemClassMatchupT{};
+    }
+
+    for (int i = 0; i < 1326; i++) {
+      for (int j = 0; j < 1326; j++) {
+	if ((combos[i].card_bits & combos[j].card_bits) == 0) {
+	  matchups[combos[i].hole_class*N_CLASSES + combos[j].hole_class].n_outcomes += Equity::N_BOARDS_PER_HOLDEM_MATCHUP;
+	}
+      }
+    }
+
+    BoardEnum::for_each_canonical_board((const U8CardT*)nullptr, 0, [&](const U8CardT* board, u64 weight) { eval_board(board, weight); });
+
+    for (const auto& counts: weighted_counts) {
+      for (int c0 = 0; c0 < N_CLASSES; c0++) {
+	for (int c1 = 0; c1 < N_CLASSES; c1++) {
+	  Equity::HoldemClassMatchupT& matchup = matchups[c0*N_CLASSES + c1];
+	  matchup.p0_wins += counts.weight * counts.wins[c0*COUNTS_ROW_LEN + c1];
+	  matchup.ties += counts.weight * counts.ties[c0*COUNTS_ROW_LEN + c1];
+	}
+      }
+    }
+  }
+};
+
+void Poker::Equity::generate_holdem_preflop_equity_matrix(HoldemClassMatchupT* matchups) {
+  // Too big for the stack
+  std::vector<HoldemEquityGeneratorT> generator(1);
+  generator[0].generate(matchups);
+}
+
+// Mapped from the table file on first use, generating the file if necessary
+static const Equity::HoldemClassMatchupT* holdem_preflop_equity_table() {
+  static const Equity::HoldemClassMatchupT* table =
+    TableFile::load_or_generate_table<Equity::HoldemClassMatchupT>("holdem-preflop-equity", TableFile::HoldemPreflopEquityTable, HOLDEM_PREFLOP_EQUITY_TABLE_VERSION, Equity::N_HOLDEM_CLASS_MATCHUPS, Equity::generate_holdem_preflop_equity_matrix);
+  return table;
+}
+
+void Poker::Equity::load_holdem_preflop_equity_matrix() {
+  holdem_preflop_equity_table();
+}
+
+const Equity::HoldemClassMatchupT& Poker::Equity::holdem_preflop_equity(int p0_class, int p1_class) {
+  return holdem_preflop_equity_table()[p0_class*N_CLASSES + p1_class];
+}
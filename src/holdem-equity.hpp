@@ -0,0 +1,50 @@
+#ifndef HOLDEM_EQUITY_HPP
+#define HOLDEM_EQUITY_HPP
+
+#include <cstddef>
+
+#include "types.hpp"
+#include "normal.hpp"
+
+namespace Poker {
+  namespace Equity {
+
+    // Boards per pair of (disjoint) hole hands - 48 choose 5
+    const u64 N_BOARDS_PER_HOLDEM_MATCHUP = 1712304;
+
+    // Exact heads-up all-in showdown outcomes for a pair of preflop hole classes.
+    // Counts are over all (p0 hole, p1 hole, board) deals with p0's hole in the first class,
+    //   p1's hole in the second class and no card shared - i.e. suit overlap between the two
+    //   classes is accounted for exactly.
+    struct HoldemClassMatchupT {
+      u64 n_outcomes;
+      u64 p0_wins;
+      u64 ties;
+
+      // Number of disjoint (p0 hole, p1 hole) combo pairs - proportional to the matchup probability
+      inline u64 n_combo_pairs() const { return n_outcomes / N_BOARDS_PER_HOLDEM_MATCHUP; }
+
+      inline u64 p1_wins() const { return n_outcomes - p0_wins - ties; }
+
+      inline double p0_win_p() const { return n_outcomes == 0 ? 0.0 : (double)p0_wins / (double)n_outcomes; }
+      inline double tie_p() const { return n_outcomes == 0 ? 0.0 : (double)ties / (double)n_outcomes; }
+      inline double p1_win_p() const { return n_outcomes == 0 ? 0.0 : (double)p1_wins() / (double)n_outcomes; }
+    };
+
+    const std::size_t N_HOLDEM_CLASS_MATCHUPS = Normal::N_HOLDEM_HOLE_CLASSES * Normal::N_HOLDEM_HOLE_CLASSES;
+
+    // Exhaustively evaluate every board against every pair of hole hands - takes a while.
+    // @param matchups [N_HOLDEM_CLASS_MATCHUPS] indexed by p0_class*N_HOLDEM_HOLE_CLASSES + p1_class
+    extern void generate_holdem_preflop_equity_matrix(HoldemClassMatchupT* matchups);
+
+    // Map the equity matrix from the table file, generating and persisting it if necessary.
+    // Must be called before holdem_preflop_equity() if that is used from multiple threads.
+    extern void load_holdem_preflop_equity_matrix();
+
+    // @return exact showdown outcomes of p0_class against p1_class
+    extern const HoldemClassMatchupT& holdem_preflop_equity(int p0_class, int p1_class);
+
+  } // namespace Equity
+} // namespace Poker
+
+#endif //ndef HOLDEM_EQUITY_HPP
@@ -1,7 +1,10 @@
 #include <algorithm>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <utility>
 
+#include "board-enum.hpp"
 #include "dealer.hpp"
 #include "hand-eval.hpp"
 #include "normal.hpp"
@@ -9,7 +12,8 @@
 
 using namespace Poker;
 
-static void dump_action_and_value(std::pair<int, double> action_and_value[13][13]) {
+// Entries are indexed by hole card class - see Normal::holdem_hole_class()
+static void dump_action_and_value(std::pair<int, double> action_and_value[Normal::N_HOLDEM_HOLE_CLASSES]) {
   printf("                                                    suited\n\n");
   printf("       A       K       Q       J       X       9       8       7       6       5       4       3       2\n");
   printf("    -------------------------------------------------------------------------------------------------------\n");
@@ -18,7 +22,8 @@ static void dump_action_and_value(std::pair<int, double> action_and_value[13][13
     printf(" %c |", RANK_CHARS[rank0]);
     
     for (int rank1 = Ace; rank1 > AceLow; rank1--) {
-      std::pair<int, double>& entry = action_and_value[rank0-1][rank1-1];
+      // Suited above the diagonal, offsuit below
+      std::pair<int, double>& entry = action_and_value[Normal::holdem_hole_class((RankT)rank0, (RankT)rank1, /*is_suited*/rank0 > rank1)];
       printf(" %+4.2lf |", entry.second/entry.first);
     }
 
@@ -28,42 +33,82 @@ static void dump_action_and_value(std::pair<int, double> action_and_value[13][13
   printf("\n                                                    offsuit\n");
 }
 
-static void add_action_and_value(std::pair<int, double> action_and_value[13][13], std::pair<CardT, CardT> hole_normal, double value) {
-  CardT card0 = hole_normal.first;
-  CardT card1 = hole_normal.second;
-  
-  // hole_normal is always ace-high
-  int i0 = (int)card0.rank - 1;
-  int i1 = (int)card1.rank - 1;
-
-  if (card0.suit != card1.suit) {
-    std::swap(i0, i1);
-  }
-
-  std::pair<int, double>& entry = action_and_value[i0][i1];
+static void add_action_and_value(std::pair<int, double> action_and_value[Normal::N_HOLDEM_HOLE_CLASSES], int hole_class, double value) {
+  std::pair<int, double>& entry = action_and_value[hole_class];
 
   entry.first++;
   entry.second += value;
 }
 
-static void add_action_and_value_by_p1_hole(std::pair<int, double> (*p0_action_and_value_by_p1_hole)[13][13][13], std::pair<CardT, CardT> p0_hole_normal, std::pair<CardT, CardT> p1_hole_normal, double value) {
-  CardT p0_card0 = p0_hole_normal.first;
-  CardT p0_card1 = p0_hole_normal.second;
-  
-  // hole_normal is always ace-high
-  int p0_i0 = (int)p0_card0.rank - 1;
-  int p0_i1 = (int)p0_card1.rank - 1;
+// Parse hole cards such as "AhKd"
+static bool parse_hole(const char* s, U8CardT hole[2]) {
+  return std::strlen(s) == 4 && parse_u8card(s, hole[0]) && parse_u8card(s+2, hole[1]);
+}
 
-  if (p0_card0.suit != p0_card1.suit) {
-    std::swap(p0_i0, p0_i1);
+// Exact EV of one hole-card matchup over every board, or over suit-isomorphic boards with weights.
+static void exact_matchup(const char* p0_hole_str, const char* p1_hole_str, bool canonical_boards) {
+  U8CardT holes[4];
+  if (!parse_hole(p0_hole_str, holes) || !parse_hole(p1_hole_str, holes+2)) {
+    fprintf(stderr, "bad hole cards %s %s - expecting e.g. AhKd QsQc\n", p0_hole_str, p1_hole_str);
+    exit(1);
+  }
+  for (int i = 0; i < 4; i++) {
+    for (int j = i+1; j < 4; j++) {
+      if (holes[i].u8_card == holes[j].u8_card) {
+	fprintf(stderr, "duplicate hole cards %s %s\n", p0_hole_str, p1_hole_str);
+	exit(1);
+      }
+    }
   }
 
-  std::pair<int, double> (*p1_hole_action_and_value)[13] = p0_action_and_value_by_p1_hole[p0_i0][p0_i1];
+  const HandT p0_hole_hand = HandT(HandT(holes[0]), HandT(holes[1]));
+  const HandT p1_hole_hand = HandT(HandT(holes[2]), HandT(holes[3]));
 
-  add_action_and_value(p1_hole_action_and_value, p1_hole_normal, value);
+  u64 n_boards_visited = 0;
+  u64 n_boards = 0;
+  u64 p0_wins = 0;
+  u64 p0_ties = 0;
+
+  auto eval_board = [&](const U8CardT* board, u64 weight) {
+    HandT board_hand;
+    for (int i = 0; i < BoardEnum::N_BOARD_CARDS; i++) {
+      board_hand.add(board[i]);
+    }
+
+    auto p0_hand_eval = HandEval::eval_hand_5_to_9_card_compact_fast1(HandT(board_hand, p0_hole_hand));
+    auto p1_hand_eval = HandEval::eval_hand_5_to_9_card_compact_fast1(HandT(board_hand, p1_hole_hand));
+
+    n_boards_visited++;
+    n_boards += weight;
+    if (p0_hand_eval > p1_hand_eval) {
+      p0_wins += weight;
+    } else if (p0_hand_eval == p1_hand_eval) {
+      p0_ties += weight;
+    }
+  };
+
+  if (canonical_boards) {
+    BoardEnum::for_each_canonical_board(holes, 2, eval_board);
+  } else {
+    BoardEnum::for_each_board(holes, 4, eval_board);
+  }
+
+  u64 p0_losses = n_boards - p0_wins - p0_ties;
+
+  printf("%s vs %s - %lu boards (%lu visited) / p0 win %6.4lf%% push %6.4lf%% lose %6.4lf%% / p0 EV %+7.5lf\n",
+	 p0_hole_str, p1_hole_str, n_boards, n_boards_visited,
+	 (double)p0_wins/n_boards*100.0, (double)p0_ties/n_boards*100.0, (double)p0_losses/n_boards*100.0,
+	 ((double)p0_wins - (double)p0_losses)/n_boards);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  // Exact matchup, e.g. holdem-ev AhKd QsQc [all-boards]
+  if (argc > 2) {
+    bool canonical_boards = !(argc > 3 && std::strcmp(argv[3], "all-boards") == 0);
+    exact_matchup(argv[1], argv[2], canonical_boards);
+    return 0;
+  }
+
   std::seed_seq seed{2, 3, 5, 7, 13};
   Dealer::DealerT dealer(seed);
 
@@ -72,10 +117,10 @@ int main() {
   double p0_total_value = 0.0;
   double p1_total_value = 0.0;
 
-  std::pair<int, double> p0_action_and_value[13][13] = {};
-  std::pair<int, double> p1_action_and_value[13][13] = {};
+  std::pair<int, double> p0_action_and_value[Normal::N_HOLDEM_HOLE_CLASSES] = {};
+  std::pair<int, double> p1_action_and_value[Normal::N_HOLDEM_HOLE_CLASSES] = {};
 
-  std::pair<int, double> (*p0_action_and_value_by_p1_hole)[13][13][13] = new std::pair<int, double>[13][13][13][13];
+  std::pair<int, double> (*p0_action_and_value_by_p1_hole)[Normal::N_HOLDEM_HOLE_CLASSES] = new std::pair<int, double>[Normal::N_HOLDEM_HOLE_CLASSES][Normal::N_HOLDEM_HOLE_CLASSES]();
 
   for(int deal_no = 0; deal_no < N_DEALS; deal_no++) {
     auto cards = dealer.deal(2+2+3+1+1);
@@ -83,8 +128,8 @@ int main() {
     auto p0_hole = std::make_pair(CardT(cards[0+0]), CardT(cards[0+1]));
     auto p1_hole = std::make_pair(CardT(cards[2+0]), CardT(cards[2+1]));
 
-    auto p0_hole_normal = Normal::holdem_hole_normal(p0_hole.first, p0_hole.second);
-    auto p1_hole_normal = Normal::holdem_hole_normal(p1_hole.first, p1_hole.second);
+    const int p0_hole_class = Normal::holdem_hole_class(cards[0+0], cards[0+1]);
+    const int p1_hole_class = Normal::holdem_hole_class(cards[2+0], cards[2+1]);
 
     auto flop = std::make_tuple(CardT(cards[2*2]), CardT(cards[2*2 + 1]), CardT(cards[2*2 + 2]));
     auto turn = CardT(cards[2*2 + 3]);
@@ -107,10 +152,10 @@ int main() {
     p0_total_value += p0_hand_value;
     p1_total_value += p1_hand_value;
 
-    add_action_and_value(p0_action_and_value, p0_hole_normal, p0_hand_value);
-    add_action_and_value(p1_action_and_value, p1_hole_normal, p1_hand_value);
+    add_action_and_value(p0_action_and_value, p0_hole_class, p0_hand_value);
+    add_action_and_value(p1_action_and_value, p1_hole_class, p1_hand_value);
 
-    add_action_and_value_by_p1_hole(p0_action_and_value_by_p1_hole, p0_hole_normal, p1_hole_normal, p0_hand_value);
+    add_action_and_value(p0_action_and_value_by_p1_hole[p0_hole_class], p1_hole_class, p0_hand_value);
   }
 
   printf("%d deals / p0 EV %+4.2lf / p1 EV %+4.2lf\n", N_DEALS, p0_total_value/N_DEALS, p1_total_value/N_DEALS);
@@ -124,9 +169,9 @@ int main() {
 
   for (int rank0 = Ace; rank0 > AceLow; rank0--) {
     for (int rank1 = Ace; rank1 > AceLow; rank1--) {
-      printf("Player 0 %c%c%c vs Player 1:\n\n", RANK_CHARS[rank0], RANK_CHARS[rank1], (rank0 < rank1 ? 's' : 'o'));
+      printf("Player 0 %c%c%c vs Player 1:\n\n", RANK_CHARS[rank0], RANK_CHARS[rank1], (rank0 > rank1 ? 's' : 'o'));
 
-      dump_action_and_value(p0_action_and_value_by_p1_hole[rank0-1][rank1-1]);
+      dump_action_and_value(p0_action_and_value_by_p1_hole[Normal::holdem_hole_class((RankT)rank0, (RankT)rank1, /*is_suited*/rank0 > rank1)]);
 
       printf("\n");
     }
@@ -8,6 +8,9 @@ typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
 
+typedef int32_t i32;
+typedef int64_t i64;
+
 namespace Poker {
 
   enum SuitT: u8 {
@@ -126,6 +129,34 @@ namespace Poker {
     return U8CardT((u8)((to_ace_low(card.rank) << 2) + card.suit));
   }
 
+  // Parse a card such as "Ah", "Td" or "2c" - "T" and "X" are both Ten, and rank chars are case-insensitive
+  // @return true on success
+  static inline bool parse_u8card(const char* s, U8CardT& card) {
+    static const char* PARSE_RANK_CHARS = "A23456789TJQK";
+
+    char rank_char = (s[0] == 'x' || s[0] == 'X') ? 'T' : (char)(s[0] >= 'a' && s[0] <= 'z' ? s[0] - 'a' + 'A' : s[0]);
+    int rank = -1;
+    for (int r = AceLow; r < Ace; r++) {
+      if (rank_char != '\0' && PARSE_RANK_CHARS[r] == rank_char) {
+	rank = r;
+      }
+    }
+
+    int suit = -1;
+    for (int su = Spades; su < NSuits; su++) {
+      if (s[0] != '\0' && SUIT_CHARS[su] == s[1]) {
+	suit = su;
+      }
+    }
+
+    if (rank < 0 || suit < 0) {
+      return false;
+    }
+
+    card = U8CardT((u8)((rank << 2) + suit));
+    return true;
+  }
+
   struct HandT {
     union {
       RankBitsT suits[NSuits];
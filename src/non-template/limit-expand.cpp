@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "limit-config.hpp"
+#include "limit-expand.hpp"
+
+// Progressive tree expansion within a node budget - see limit-expand.hpp.
+
+using Poker::RANK_CHARS;
+using Poker::RankT;
+
+// Average raise probability of the first player to act preflop, by hole class - suited top right, offsuit bottom left
+template <std::size_t N_PLAYERS>
+void dump_first_to_act_strategy(Limit::Expand::ExpandSolverT<N_PLAYERS>& solver) {
+  const auto* node = solver.root->child;
+  if (node == 0 || !node->is_expanded) {
+    return;
+  }
+  const Limit::Expand::BettingStateT& state = solver.get_betting_state(node);
+
+  printf("P%zu (first to act) raise %%\n\n    ", node->player_no);
+  for (int rank2 = Poker::Ace; rank2 > Poker::AceLow; rank2--) {
+    printf("   %c ", RANK_CHARS[rank2]);
+  }
+  printf("\n");
+  for (int rank1 = Poker::Ace; rank1 > Poker::AceLow; rank1--) {
+    printf("  %c ", RANK_CHARS[rank1]);
+    for (int rank2 = Poker::Ace; rank2 > Poker::AceLow; rank2--) {
+      const int hole_class = Poker::Normal::holdem_hole_class((RankT)rank1, (RankT)rank2, /*is_suited*/rank2 < rank1);
+      printf(" %3.0f ", state.get_average_strategy(hole_class)[Limit::Expand::RAISE]*100.0);
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+template <std::size_t N_PLAYERS>
+void count_street_nodes(const Limit::GameTree::GameTreeNodeT<N_PLAYERS>* node, std::size_t counts[Limit::GameTree::N_STREETS]) {
+
+  if (node == 0) { return; }
+
+  counts[node->street]++;
+
+  count_street_nodes(node->child, counts);
+
+  count_street_nodes(node->fold, counts);
+
+  count_street_nodes(node->call, counts);
+
+  count_street_nodes(node->raise, counts);
+
+}
+
+int main(int argc, char* argv[]) {
+  constexpr std::size_t N_PLAYERS = 2;
+
+  Limit::Expand::ExpandConfigT expand_config {
+      .node_budget = 2000,
+      .n_expand_per_epoch = 32,
+      .max_n_iterations = 64,
+      .n_deals = 20000,
+      .step_size = 0.5,
+      .min_action_p = 0.001,
+      .converged_delta = 0.01,
+  };
+
+  // Usage: limit-expand [budget <n-nodes>] [expand <n-leaves>] [iterations <n>] [deals <n>] [step <step-size>] [min-p <p>] [delta <converged-delta>]
+  for (int i = 1; i < argc; i += 2) {
+    const std::string arg = argv[i];
+    if (i+1 == argc) {
+      fprintf(stderr, "limit-expand: missing value for '%s'\n", argv[i]);
+      return 1;
+    } else if (arg == "budget") {
+      expand_config.node_budget = std::atol(argv[i+1]);
+    } else if (arg == "expand") {
+      expand_config.n_expand_per_epoch = std::atol(argv[i+1]);
+    } else if (arg == "iterations") {
+      expand_config.max_n_iterations = std::atol(argv[i+1]);
+    } else if (arg == "deals") {
+      expand_config.n_deals = std::atol(argv[i+1]);
+    } else if (arg == "min-p") {
+      expand_config.min_action_p = std::atof(argv[i+1]);
+    } else if (arg == "step") {
+      expand_config.step_size = std::atof(argv[i+1]);
+    } else if (arg == "delta") {
+      expand_config.converged_delta = std::atof(argv[i+1]);
+    } else {
+      fprintf(stderr, "limit-expand: unknown argument '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+
+  const Limit::Config::ConfigT<N_PLAYERS> config {
+      .small_blind = 1.0,
+      .big_blind = 2.0,
+      .preflop_raise = 2.0,
+      .max_n_preflop_raises = 4,
+      .flop_raise = 2.0,
+      .max_n_flop_raises = 4,
+      .turn_raise = 4.0,
+      .max_n_turn_raises = 4,
+      .river_raise = 4.0,
+      .max_n_river_raises = 4,
+  };
+
+  auto root = Limit::GameTree::GameTreeNodeT<N_PLAYERS>::new_root(config);
+
+  std::seed_seq seed{1, 2, 3, 4, 5};
+  Limit::Expand::ExpandSolverT<N_PLAYERS> solver(root, expand_config, seed);
+
+  for (std::size_t epoch = 0; ; epoch++) {
+    double delta;
+    const std::size_t n_iterations = solver.rebalance(delta);
+
+    printf("Epoch %4zu: %6zu nodes, %5zu betting nodes, %5zu leaves - %2zu iterations, delta %.4f\n", epoch, solver.n_nodes, solver.betting_states.size(), solver.leaf_states.size(), n_iterations, delta);
+    if (delta >= expand_config.converged_delta) {
+      printf("WARNING: epoch %zu didn't converge to delta %.4f in %zu iterations\n", epoch, expand_config.converged_delta, n_iterations);
+    }
+
+    if (solver.n_nodes >= expand_config.node_budget || solver.expand_tree() == 0) {
+      break;
+    }
+  }
+
+  std::size_t counts[Limit::GameTree::N_STREETS] = {};
+  count_street_nodes(root, counts);
+  printf("\n%zu players - %zu nodes:", N_PLAYERS, solver.n_nodes);
+  for (int street = 0; street < Limit::GameTree::N_STREETS; street++) {
+    printf(" %s %zu", Limit::GameTree::STREET_NAMES[street], counts[street]);
+  }
+  printf("\n\n");
+
+  dump_first_to_act_strategy(solver);
+}
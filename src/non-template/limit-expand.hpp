@@ -0,0 +1,441 @@
+#ifndef LIMIT_EXPAND_HPP
+#define LIMIT_EXPAND_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+#include "dealer.hpp"
+#include "flop-category.hpp"
+#include "hand-eval.hpp"
+#include "normal.hpp"
+
+#include "limit-game-tree.hpp"
+
+namespace Limit {
+
+  namespace Expand {
+
+    // Progressive expansion of a truncated game tree - see docs/game-tree-eval.txt.
+    //
+    // Each epoch rebalances the strategies of the current (truncated) tree by monte-carlo sampling
+    //   and then expands the leaves with the highest prob x |EV| one level, until the tree reaches the
+    //   node budget. Unexpanded leaves are evaluated as a showdown of the players still in.
+    //
+    // Sampled rebalancing doesn't settle on a single strategy - like CFR the strategies cycle around the
+    //   equilibrium - so the solution is the average strategy over the epoch's iterations, weighted by
+    //   the player's own reach.
+    //
+    // Strategies are held per betting node and per class of the player to act - the hole card class
+    //   preflop and the flop category (see Poker::FlopCategory) from the flop on.
+
+    using Poker::CardT;
+    using Poker::U8CardT;
+
+    const std::size_t N_ACTIONS = 3;
+    const std::size_t FOLD = 0;
+    const std::size_t CALL = 1;
+    const std::size_t RAISE = 2;
+
+    static inline std::size_t street_n_classes(GameTree::street_t street) {
+      return street == GameTree::PREFLOP_STREET ? Poker::Normal::N_HOLDEM_HOLE_CLASSES : (std::size_t)Poker::FlopCategory::N_FLOP_CATEGORIES;
+    }
+
+    struct ExpandConfigT {
+      // Stop expanding once the tree has this many nodes
+      std::size_t node_budget;
+      // Leaves expanded per epoch
+      std::size_t n_expand_per_epoch;
+      // Max rebalance iterations per epoch
+      std::size_t max_n_iterations;
+      // Hands sampled per rebalance iteration
+      std::size_t n_deals;
+      // Damping of the strategy update - 1.0 is the full tanh step
+      double step_size;
+      // Action probabilities are clamped to at least this, stealing from the most likely action, so that a
+      //   strategy can still move once expansion changes the EVs below it
+      double min_action_p;
+      // Rebalancing has converged when an iteration moves the average strategies by less than this per hand -
+      //   see rebalance_strategies()
+      double converged_delta;
+    };
+
+    // Rebalance state of one betting node.
+    struct BettingStateT {
+      // Per class of the player to act
+      std::vector<std::array<double, N_ACTIONS>> action_p;
+      // Sampled counterfactual activity and action profits of the player to act - per class
+      std::vector<double> activity;
+      std::vector<std::array<double, N_ACTIONS>> profits;
+      // Sampled own reach of the player to act - per class
+      std::vector<double> reach;
+      // Own reach weighted sums of action_p over the epoch's iterations - per class
+      std::vector<std::array<double, N_ACTIONS>> strategy_sums;
+
+      // Average strategy of the epoch so far, or the current strategy if the class hasn't been reached
+      std::array<double, N_ACTIONS> get_average_strategy(std::size_t c) const {
+	const double sum = this->strategy_sums[c][FOLD] + this->strategy_sums[c][CALL] + this->strategy_sums[c][RAISE];
+	if (sum == 0.0) {
+	  return this->action_p[c];
+	}
+	std::array<double, N_ACTIONS> average_p;
+	for (std::size_t a = 0; a < N_ACTIONS; a++) {
+	  average_p[a] = this->strategy_sums[c][a]/sum;
+	}
+	return average_p;
+      }
+    };
+
+    // Sampled reach and impact of an unexpanded leaf
+    struct LeafStateT {
+      // Sum of the traverser's reach probability over all traversals
+      double activity;
+      // Sum of reach probability x |profit| of the traverser
+      double value;
+    };
+
+    // One sampled hand
+    template <std::size_t N_PLAYERS>
+    struct DealT {
+      std::array<int, N_PLAYERS> hole_classes;
+      std::array<int, N_PLAYERS> flop_categories;
+      std::array<Poker::HandEval::HandEvalT, N_PLAYERS> hand_evals;
+
+      int get_class(GameTree::street_t street, std::size_t player_no) const {
+	return street == GameTree::PREFLOP_STREET ? this->hole_classes[player_no] : this->flop_categories[player_no];
+      }
+    };
+
+    template <std::size_t N_PLAYERS>
+    struct ExpandSolverT {
+
+      typedef GameTree::GameTreeNodeT<N_PLAYERS> NodeT;
+
+      NodeT* const root;
+      const ExpandConfigT config;
+
+      Poker::Dealer::DealerT dealer;
+
+      // Nodes in the tree, including terminal nodes
+      std::size_t n_nodes;
+      // Traversals since the leaf states were reset
+      std::size_t n_traversals;
+
+      std::unordered_map<const NodeT*, BettingStateT> betting_states;
+      std::unordered_map<const NodeT*, LeafStateT> leaf_states;
+      // Node numbers in order of creation - a stable order for expansion, unlike the node addresses
+      std::unordered_map<const NodeT*, std::size_t> node_nos;
+
+      ExpandSolverT(NodeT* root, const ExpandConfigT& config, std::seed_seq& seed):
+	root(root), config(config), dealer(seed), n_nodes(1), n_traversals(0), node_nos({ { root, 0 } }) {}
+
+      // New betting nodes start with a balanced mixed strategy.
+      BettingStateT& get_betting_state(const NodeT* node) {
+	auto it = this->betting_states.find(node);
+	if (it != this->betting_states.end()) {
+	  return it->second;
+	}
+
+	const std::size_t n_classes = street_n_classes(node->street);
+	const std::size_t n_actions = node->n_raises_left > 0 ? 3 : 2;
+	std::array<double, N_ACTIONS> action_p{};
+	for (std::size_t a = 0; a < n_actions; a++) {
+	  action_p[a] = 1.0/n_actions;
+	}
+
+	BettingStateT& state = this->betting_states[node];
+	state.action_p.assign(n_classes, action_p);
+	state.activity.assign(n_classes, 0.0);
+	state.profits.assign(n_classes, std::array<double, N_ACTIONS>{});
+	state.reach.assign(n_classes, 0.0);
+	state.strategy_sums.assign(n_classes, std::array<double, N_ACTIONS>{});
+	return state;
+      }
+
+      DealT<N_PLAYERS> deal_hand() {
+	U8CardT cards[2*N_PLAYERS + 5];
+	this->dealer.deal(cards, 2*N_PLAYERS + 5);
+
+	const U8CardT* board = &cards[2*N_PLAYERS];
+	auto flop = std::make_tuple(CardT(board[0]), CardT(board[1]), CardT(board[2]));
+	auto turn = CardT(board[3]);
+	auto river = CardT(board[4]);
+
+	DealT<N_PLAYERS> deal;
+	for (std::size_t n = 0; n < N_PLAYERS; n++) {
+	  auto hole = std::make_pair(CardT(cards[2*n + 0]), CardT(cards[2*n + 1]));
+	  deal.hole_classes[n] = Poker::Normal::holdem_hole_class(cards[2*n + 0], cards[2*n + 1]);
+	  deal.flop_categories[n] = Poker::FlopCategory::holdem_flop_category(cards[2*n + 0], cards[2*n + 1], board[0], board[1], board[2]);
+	  deal.hand_evals[n] = Poker::HandEval::eval_hand_holdem(hole, flop, turn, river);
+	}
+
+	return deal;
+      }
+
+      // Profit of a player at a terminal node, or at an unexpanded node as if it were a showdown.
+      static double get_profit(const NodeT* node, std::size_t player_no, const DealT<N_PLAYERS>& deal) {
+	if (node->players_folded[player_no]) {
+	  return -node->players_bets[player_no];
+	}
+
+	if (node->node_type == GameTree::STEAL_NODE) {
+	  return node->pot - node->players_bets[player_no];
+	}
+
+	// Best active hand(s) win
+	Poker::HandEval::HandEvalT winners_eval;
+	std::size_t n_winners = 0;
+	for (std::size_t n = 0; n < N_PLAYERS; n++) {
+	  if (node->players_folded[n]) {
+	    continue;
+	  }
+	  if (n_winners == 0 || winners_eval < deal.hand_evals[n]) {
+	    winners_eval = deal.hand_evals[n];
+	    n_winners = 1;
+	  } else if (deal.hand_evals[n] == winners_eval) {
+	    n_winners++;
+	  }
+	}
+
+	if (deal.hand_evals[player_no] != winners_eval) {
+	  return -node->players_bets[player_no];
+	}
+
+	return node->pot/n_winners - node->players_bets[player_no];
+      }
+
+      // External-sampling traversal of one hand - the traverser explores all of their actions, everyone
+      //   else plays a single action sampled from their strategy.
+      // @param reach is the traverser's own reach probability
+      // @return the traverser's profit
+      double sample_hand(const NodeT* node, std::size_t traverser_no, const DealT<N_PLAYERS>& deal, double reach) {
+	if (node->street == GameTree::RESULT_STREET) {
+	  return get_profit(node, traverser_no, deal);
+	}
+
+	if (!node->is_expanded) {
+	  const double profit = get_profit(node, traverser_no, deal);
+	  LeafStateT& leaf_state = this->leaf_states[node];
+	  leaf_state.activity += reach;
+	  leaf_state.value += reach*std::fabs(profit);
+	  return profit;
+	}
+
+	if (node->node_type == GameTree::DEAL_NODE) {
+	  return sample_hand(node->child, traverser_no, deal, reach);
+	}
+
+	assert(node->node_type == GameTree::BETTING_NODE);
+
+	const NodeT* children[N_ACTIONS] = { node->fold, node->call, node->raise };
+	const std::size_t n_actions = node->raise != 0 ? 3 : 2;
+
+	BettingStateT& state = get_betting_state(node);
+	const int player_class = deal.get_class(node->street, node->player_no);
+	const std::array<double, N_ACTIONS>& action_p = state.action_p[player_class];
+
+	if (node->player_no != traverser_no) {
+	  std::uniform_real_distribution<double> dist(0.0, 1.0);
+	  double r = dist(this->dealer.rng);
+	  std::size_t action = 0;
+	  while (action < n_actions-1 && r >= action_p[action]) {
+	    r -= action_p[action];
+	    action++;
+	  }
+	  return sample_hand(children[action], traverser_no, deal, reach);
+	}
+
+	state.activity[player_class] += 1.0;
+	state.reach[player_class] += reach;
+
+	double profit = 0.0;
+	for (std::size_t a = 0; a < n_actions; a++) {
+	  const double action_profit = sample_hand(children[a], traverser_no, deal, reach*action_p[a]);
+	  state.profits[player_class][a] += action_profit;
+	  profit += action_p[a]*action_profit;
+	}
+
+	return profit;
+      }
+
+      void reset_evals() {
+	for (auto& node_state : this->betting_states) {
+	  BettingStateT& state = node_state.second;
+	  std::fill(state.activity.begin(), state.activity.end(), 0.0);
+	  std::fill(state.profits.begin(), state.profits.end(), std::array<double, N_ACTIONS>{});
+	  std::fill(state.reach.begin(), state.reach.end(), 0.0);
+	}
+	this->leaf_states.clear();
+	this->n_traversals = 0;
+      }
+
+      // Start a new epoch's average strategies
+      void reset_strategy_sums() {
+	for (auto& node_state : this->betting_states) {
+	  BettingStateT& state = node_state.second;
+	  std::fill(state.strategy_sums.begin(), state.strategy_sums.end(), std::array<double, N_ACTIONS>{});
+	}
+      }
+
+      // Accumulate the strategies played in this iteration into the average strategies, and then a damped
+      //   multiplicative strategy update from the sampled action EVs: p *= (step_size*tanh((ev_action - ev)/pot) + 1),
+      //   renormalised.
+      // The doc uses tanh(ev_action) but here EVs are relative to the node EV, so that the update doesn't depend
+      //   on what the player has already put in, and in units of the pot, so that deep streets don't snap to pure
+      //   strategies on sampling noise.
+      // @return the change in the average strategies - the sum over betting nodes and classes of the own reach
+      //   per hand times the max change in an action probability, so that rarely reached classes don't dominate
+      double rebalance_strategies() {
+	double delta = 0.0;
+
+	for (auto& node_state : this->betting_states) {
+	  BettingStateT& state = node_state.second;
+	  const std::size_t n_actions = node_state.first->raise != 0 ? 3 : 2;
+	  const double pot = node_state.first->pot;
+
+	  for (std::size_t c = 0; c < state.action_p.size(); c++) {
+	    if (state.activity[c] == 0.0) {
+	      continue;
+	    }
+	    std::array<double, N_ACTIONS>& action_p = state.action_p[c];
+
+	    const std::array<double, N_ACTIONS> old_average_p = state.get_average_strategy(c);
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      state.strategy_sums[c][a] += state.reach[c]*action_p[a];
+	    }
+	    const std::array<double, N_ACTIONS> average_p = state.get_average_strategy(c);
+	    double class_delta = 0.0;
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      class_delta = std::max(class_delta, std::fabs(average_p[a] - old_average_p[a]));
+	    }
+	    delta += state.reach[c]/this->config.n_deals*class_delta;
+
+	    double evs[N_ACTIONS];
+	    double ev = 0.0;
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      evs[a] = state.profits[c][a]/state.activity[c];
+	      ev += action_p[a]*evs[a];
+	    }
+
+	    double new_action_p[N_ACTIONS];
+	    double sum_p = 0.0;
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      new_action_p[a] = action_p[a]*(this->config.step_size*std::tanh((evs[a] - ev)/pot) + 1.0);
+	      sum_p += new_action_p[a];
+	    }
+	    if (sum_p <= 0.0) {
+	      continue;
+	    }
+
+	    std::size_t max_a = 0;
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      action_p[a] = new_action_p[a]/sum_p;
+	      if (action_p[a] > action_p[max_a]) {
+		max_a = a;
+	      }
+	    }
+	    for (std::size_t a = 0; a < n_actions; a++) {
+	      if (action_p[a] < this->config.min_action_p) {
+		action_p[max_a] -= this->config.min_action_p - action_p[a];
+		action_p[a] = this->config.min_action_p;
+	      }
+	    }
+	  }
+	}
+
+	return delta;
+      }
+
+      // One rebalance iteration - sample config.n_deals hands, each traversed by every player, then update.
+      // @return the change in the average strategies - see rebalance_strategies()
+      double rebalance_iteration() {
+	reset_evals();
+
+	for (std::size_t i = 0; i < this->config.n_deals; i++) {
+	  const DealT<N_PLAYERS> deal = deal_hand();
+	  for (std::size_t traverser_no = 0; traverser_no < N_PLAYERS; traverser_no++) {
+	    sample_hand(this->root, traverser_no, deal, 1.0);
+	    this->n_traversals++;
+	  }
+	}
+
+	return rebalance_strategies();
+      }
+
+      // Rebalance until the average strategies have converged, or config.max_n_iterations.
+      // The leaf states are those of the last iteration.
+      // @return the number of iterations
+      std::size_t rebalance(double& delta) {
+	reset_strategy_sums();
+	std::size_t n_iterations = 0;
+	delta = 0.0;
+	while (n_iterations < this->config.max_n_iterations) {
+	  delta = rebalance_iteration();
+	  n_iterations++;
+	  // The first iteration's average is just the current strategy
+	  if (n_iterations > 1 && delta < this->config.converged_delta) {
+	    break;
+	  }
+	}
+	return n_iterations;
+      }
+
+      // Number the new children of an expanded node
+      void add_children(const NodeT* node) {
+	for (const NodeT* child : { node->child, node->fold, node->call, node->raise }) {
+	  if (child != 0) {
+	    this->node_nos[child] = this->n_nodes++;
+	  }
+	}
+      }
+
+      // Expansion priority of a leaf - prob x |EV|, and then the older node first
+      struct PriorityLeafT {
+	double priority;
+	std::size_t node_no;
+	const NodeT* node;
+
+	bool operator<(const PriorityLeafT& other) const {
+	  return this->priority < other.priority || (this->priority == other.priority && this->node_no > other.node_no);
+	}
+      };
+
+      // Expand the highest prob x |EV| leaves seen by the last rebalance iteration, up to
+      //   config.n_expand_per_epoch of them and while the tree is within the node budget.
+      // Expansion is one level - the new children are leaves for the next epoch.
+      // @return the number of leaves expanded
+      std::size_t expand_tree() {
+	std::priority_queue<PriorityLeafT> queue;
+
+	for (const auto& leaf : this->leaf_states) {
+	  const double prob = leaf.second.activity/this->n_traversals;
+	  const double abs_ev = leaf.second.activity == 0.0 ? 0.0 : leaf.second.value/leaf.second.activity;
+	  queue.push(PriorityLeafT{ prob*abs_ev, this->node_nos.at(leaf.first), leaf.first });
+	}
+
+	std::size_t n_expanded = 0;
+	while (!queue.empty() && n_expanded < this->config.n_expand_per_epoch && this->n_nodes < this->config.node_budget) {
+	  NodeT* node = const_cast<NodeT*>(queue.top().node);
+	  queue.pop();
+
+	  node->expand();
+	  add_children(node);
+	  n_expanded++;
+	}
+
+	return n_expanded;
+      }
+
+    }; // struct ExpandSolverT
+
+  } // namespace Expand
+
+} // namespace Limit
+
+#endif //def LIMIT_EXPAND_HPP
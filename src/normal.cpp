@@ -1,85 +1,542 @@
 #include <algorithm>
 #include <cassert>
-#include <map>
 #include <utility>
+#include <vector>
 
 #include "types.hpp"
 #include "normal.hpp"
+#include "table-file.hpp"
 #include "util.hpp"
 
 using namespace Poker;
 
-static bool OMAHA_HOLE_NORMAL_INDEX_INITED = false;
-static int OMAHA_HOLE_NORMAL_INDEX[52][52][52][52];
-static std::tuple<CardT, CardT, CardT, CardT> OMAHA_HOLE_NORMAL_FROM_INDEX[Poker::Normal::N_OMAHA_HOLE_NORMALS];
+// n choose k for the small n, k we need for colex ranking - n <= 16, k <= 4
+static constexpr int choose(int n, int k) {
+  if(k < 0 || n < k) {
+    return 0;
+  }
+  int c = 1;
+  for(int i = 0; i < k; i++) {
+    c = c * (n - i) / (i + 1);
+  }
+  return c;
+}
+
+// Tabulated choose() for n, k <= 16 - avoids divisions on per-deal paths
+struct SmallChooseT {
+  int n_choose_k[17][17];
+
+  constexpr SmallChooseT(): n_choose_k() {
+    for (int n = 0; n <= 16; n++) {
+      for (int k = 0; k <= 16; k++) {
+	n_choose_k[n][k] = choose(n, k);
+      }
+    }
+  }
+};
+
+static constexpr SmallChooseT SMALL_CHOOSE;
+
+static inline int small_choose(int n, int k) {
+  return SMALL_CHOOSE.n_choose_k[n][k];
+}
+
+// Colex rank of a set of ranks (bit i for ace-high rank Two+i) amongst all sets of the same size.
+// Note that for sets of the same size, numeric order of the bitmap is colex order.
+static inline int colex_rank(u16 rank_bits) {
+  int rank = 0;
+  for(int i = 1; rank_bits != 0; i++) {
+    int bit = __builtin_ctz(rank_bits);
+    rank += small_choose(bit, i);
+    rank_bits &= rank_bits - 1;
+  }
+  return rank;
+}
+
+// Colex rank of a multiset of two values x0 >= x1
+static inline int multiset2_rank(int x0, int x1) {
+  return choose(x0+1, 2) + x1;
+}
+
+// Colex rank of a multiset of four values x0 >= x1 >= x2 >= x3
+static inline int multiset4_rank(int x0, int x1, int x2, int x3) {
+  return choose(x0+3, 4) + choose(x1+2, 3) + choose(x2+1, 2) + x3;
+}
+
+// The normalised hole card suits - sorted by size, then bitmap - fall into one of five suit patterns.
+// Each pattern has a contiguous range of indices.
+static const int N_OMAHA_4_NORMALS    = choose(13, 4);                   //   715
+static const int N_OMAHA_3_1_NORMALS  = choose(13, 3) * 13;              // 3,718
+static const int N_OMAHA_2_2_NORMALS  = choose(choose(13, 2) + 1, 2);    // 3,081
+static const int N_OMAHA_2_1_1_NORMALS = choose(13, 2) * choose(14, 2);  // 7,098
+static const int N_OMAHA_1_1_1_1_NORMALS = choose(16, 4);                // 1,820
 
-void Poker::Normal::init_omaha_hole_normal_index() {
-  std::map<std::tuple<CardT, CardT, CardT, CardT>, int> omaha_hole_normal_to_index;
-  int next_index = 0;
+static const int OMAHA_4_OFFSET = 0;
+static const int OMAHA_3_1_OFFSET = OMAHA_4_OFFSET + N_OMAHA_4_NORMALS;
+static const int OMAHA_2_2_OFFSET = OMAHA_3_1_OFFSET + N_OMAHA_3_1_NORMALS;
+static const int OMAHA_2_1_1_OFFSET = OMAHA_2_2_OFFSET + N_OMAHA_2_2_NORMALS;
+static const int OMAHA_1_1_1_1_OFFSET = OMAHA_2_1_1_OFFSET + N_OMAHA_2_1_1_NORMALS;
+
+static_assert(OMAHA_1_1_1_1_OFFSET + N_OMAHA_1_1_1_1_NORMALS == (int)Poker::Normal::N_OMAHA_HOLE_NORMALS);
+
+// Normalised Omaha hole cards as they are persisted in the table file
+struct OmahaHoleNormalU8T {
+  U8CardT cards[4];
+};
+
+static_assert(sizeof(OmahaHoleNormalU8T) == 4);
+
+// Bump when the index or the normalisation changes
+static const u32 OMAHA_HOLE_NORMAL_FROM_INDEX_TABLE_VERSION = 1;
+
+// Only the (small) reverse mapping is tabulated - the forward index is computed directly.
+// We only need to visit each unordered set of four cards once.
+static void generate_omaha_hole_normal_from_index_table(OmahaHoleNormalU8T* table) {
+  bool seen[Normal::N_OMAHA_HOLE_NORMALS] = {};
+  std::size_t n_seen = 0;
 
   for (u8 c0 = 0; c0 < 52; c0++) {
     U8CardT c0_u8 = U8CardT(c0);
     CardT card0 = CardT(c0_u8.suit(), c0_u8.rank());
-
-    for (u8 c1 = 0; c1 < 52; c1++) {
-      bool c1_invalid = (c1 == c0);
-      
+    
+    for (u8 c1 = c0+1; c1 < 52; c1++) {
       U8CardT c1_u8 = U8CardT(c1);
       CardT card1 = CardT(c1_u8.suit(), c1_u8.rank());
     
-      for (u8 c2 = 0; c2 < 52; c2++) {
-	bool c2_invalid = (c2 == c0 || c2 == c1);
-	
+      for (u8 c2 = c1+1; c2 < 52; c2++) {
 	U8CardT c2_u8 = U8CardT(c2);
 	CardT card2 = CardT(c2_u8.suit(), c2_u8.rank());
     
-	for (u8 c3 = 0; c3 < 52; c3++) {
-	  bool c3_invalid = (c3 == c0 || c3 == c1 || c3 == c2);
-
+	for (u8 c3 = c2+1; c3 < 52; c3++) {
 	  U8CardT c3_u8 = U8CardT(c3);
 	  CardT card3 = CardT(c3_u8.suit(), c3_u8.rank());
 
-	  int index = Poker::Normal::INVALID_OMAHA_HOLE_NORMAL_INDEX;
-	  if (!c1_invalid && !c2_invalid && !c3_invalid) {
+	  int index = Normal::omaha_hole_normal_index(card0, card1, card2, card3);
+	  assert(0 <= index && (std::size_t)index < Normal::N_OMAHA_HOLE_NORMALS);
+
+	  if (!seen[index]) {
+	    seen[index] = true;
+	    n_seen++;
+
 	    auto hole_normal = Normal::omaha_hole_normal(card0, card1, card2, card3);
+	    table[index] = OmahaHoleNormalU8T{ { to_u8card(std::get<0>(hole_normal)), to_u8card(std::get<1>(hole_normal)), to_u8card(std::get<2>(hole_normal)), to_u8card(std::get<3>(hole_normal)) } };
+	  }
+	}
+      }
+    }
+  }
 
-	    auto it = omaha_hole_normal_to_index.find(hole_normal);
+  assert(n_seen == Normal::N_OMAHA_HOLE_NORMALS);
+}
 
-	    if (it != omaha_hole_normal_to_index.end()) {
-	      index = it->second;
-	    } else {
-	      index = next_index++;
+// Mapped from the table file on first use, generating the file if necessary
+static const OmahaHoleNormalU8T* omaha_hole_normal_from_index_table() {
+  static const OmahaHoleNormalU8T* table =
+    TableFile::load_or_generate_table<OmahaHoleNormalU8T>("omaha-hole-normal-from-index", TableFile::OmahaHoleNormalFromIndexTable, OMAHA_HOLE_NORMAL_FROM_INDEX_TABLE_VERSION, Normal::N_OMAHA_HOLE_NORMALS, generate_omaha_hole_normal_from_index_table);
+  return table;
+}
 
-	      omaha_hole_normal_to_index[hole_normal] = index;
+void Poker::Normal::load_omaha_hole_normal_from_index_table() {
+  omaha_hole_normal_from_index_table();
+}
 
-	      OMAHA_HOLE_NORMAL_FROM_INDEX[index] = hole_normal;
-	    }
+int Poker::Normal::omaha_hole_normal_index(CardT card0, CardT card1, CardT card2, CardT card3) {
+  const CardT cards[4] = { card0, card1, card2, card3 };
+
+  // Per-suit rank bits, with bit 0 for Two and bit 12 for Ace
+  u16 suit_ranks[NSuits] = {};
+  for (int i = 0; i < 4; i++) {
+    u16 rank_bit = (u16)(1 << (to_ace_hi(cards[i].rank) - Two));
+    if (suit_ranks[cards[i].suit] & rank_bit) {
+      return INVALID_OMAHA_HOLE_NORMAL_INDEX;
+    }
+    suit_ranks[cards[i].suit] |= rank_bit;
+  }
+
+  // Sort suits by size, then by colex order, descending
+  u32 suit_keys[NSuits];
+  for (int suit = 0; suit < NSuits; suit++) {
+    suit_keys[suit] = ((u32)Util::bitcount(suit_ranks[suit]) << 16) | suit_ranks[suit];
+  }
+  Util::sort_desc(suit_keys[0], suit_keys[1]);
+  Util::sort_desc(suit_keys[2], suit_keys[3]);
+  Util::sort_desc(suit_keys[0], suit_keys[2]);
+  Util::sort_desc(suit_keys[1], suit_keys[3]);
+  Util::sort_desc(suit_keys[1], suit_keys[2]);
+
+  const int size0 = suit_keys[0] >> 16;
+  const int size1 = suit_keys[1] >> 16;
+  const int size2 = suit_keys[2] >> 16;
+  const int rank0 = colex_rank((u16)suit_keys[0]);
+  const int rank1 = colex_rank((u16)suit_keys[1]);
+  const int rank2 = colex_rank((u16)suit_keys[2]);
+  const int rank3 = colex_rank((u16)suit_keys[3]);
+
+  if (size0 == 4) {
+    return OMAHA_4_OFFSET + rank0;
+  } else if (size0 == 3) {
+    return OMAHA_3_1_OFFSET + rank0*13 + rank1;
+  } else if (size0 == 2 && size1 == 2) {
+    return OMAHA_2_2_OFFSET + multiset2_rank(rank0, rank1);
+  } else if (size0 == 2) {
+    assert(size1 == 1 && size2 == 1);
+    return OMAHA_2_1_1_OFFSET + rank0*choose(14, 2) + multiset2_rank(rank1, rank2);
+  } else {
+    return OMAHA_1_1_1_1_OFFSET + multiset4_rank(rank0, rank1, rank2, rank3);
+  }
+}
+
+std::tuple<CardT, CardT, CardT, CardT> Poker::Normal::omaha_hole_normal_from_index(int index) {
+  assert(0 <= index && (std::size_t)index < Poker::Normal::N_OMAHA_HOLE_NORMALS);
+
+  const OmahaHoleNormalU8T& hole_normal = omaha_hole_normal_from_index_table()[index];
+
+  // U8CardT is aces-low, whereas normalised cards are aces-high
+  return std::make_tuple(to_ace_hi(CardT(hole_normal.cards[0])), to_ace_hi(CardT(hole_normal.cards[1])), to_ace_hi(CardT(hole_normal.cards[2])), to_ace_hi(CardT(hole_normal.cards[3])));
+}
+
+// n choose k for large n and small k - constant divisors on the common paths since this is per-deal
+static inline u64 choose_u64(u64 n, int k) {
+  if (n < (u64)k) {
+    return 0;
+  }
+  switch (k) {
+  case 0:
+    return 1;
+  case 1:
+    return n;
+  case 2:
+    return n*(n-1)/2;
+  case 3:
+    // Suit indices are < 2^20 so this fits in 64 bits
+    if (n < ((u64)1 << 21)) {
+      return n*(n-1)*(n-2)/6;
+    }
+    break;
+  case 4:
+    if (n < ((u64)1 << 16)) {
+      return (n*(n-1)/2) * ((n-2)*(n-3)/2) / 6;
+    }
+    break;
+  }
+  // Products are done in 128 bits
+  unsigned __int128 c = 1;
+  for (int i = 0; i < k; i++) {
+    c = c * (n - i) / (i + 1);
+  }
+  return (u64)c;
+}
+
+// Number of multisets of size k of values in [0, n)
+static inline u64 multichoose_u64(u64 n, int k) {
+  return choose_u64(n + k - 1, k);
+}
+
+static const int N_HOLDEM_RANKS = 13;
+
+// Aces-high rank bit - bit 0 is Two and bit 12 is Ace
+static inline RankBitsT holdem_rank_bit(U8CardT card) {
+  return (RankBitsT)(1 << (to_ace_hi(card.rank()) - Two));
+}
+
+static inline U8CardT holdem_card(SuitT suit, int rank_bit_no) {
+  return U8CardT((u8)((to_ace_low((RankT)(rank_bit_no + Two)) << 2) + suit));
+}
+
+// Number of cards in the given round of a per-suit config
+static inline int holdem_suit_config_count(u16 suit_config, int round) {
+  return (suit_config >> (4*(Normal::N_HOLDEM_ROUNDS-1 - round))) & 0xf;
+}
+
+// Number of distinct rank set sequences for a per-suit config, up to and including the given round
+static inline u64 holdem_suit_config_size(u16 suit_config, int round) {
+  u64 size = 1;
+  int n_remaining = N_HOLDEM_RANKS;
+  for (int r = 0; r <= round; r++) {
+    int n_cards = holdem_suit_config_count(suit_config, r);
+    size *= small_choose(n_remaining, n_cards);
+    n_remaining -= n_cards;
+  }
+  return size;
+}
+
+// Colex rank of a set of ranks, where the ranks are numbered only amongst those not already used
+static inline u64 colex_rank_remaining(RankBitsT ranks, RankBitsT used_ranks) {
+  u64 rank = 0;
+  for (int i = 1; ranks != 0; i++) {
+    int bit = __builtin_ctz(ranks);
+    int pos = bit - Util::bitcount(used_ranks & ((1 << bit) - 1));
+    rank += small_choose(pos, i);
+    ranks &= ranks - 1;
+  }
+  return rank;
+}
+
+// Inverse of colex_rank_remaining
+static inline RankBitsT colex_unrank_remaining(u64 rank, int n_ranks, RankBitsT used_ranks) {
+  RankBitsT ranks = 0;
+  for (int i = n_ranks; i > 0; i--) {
+    // Largest pos with choose(pos, i) <= rank
+    int pos = i - 1;
+    while (pos+1 < N_HOLDEM_RANKS && (u64)choose(pos+1, i) <= rank) {
+      pos++;
+    }
+    rank -= choose(pos, i);
+
+    // pos'th unused rank
+    int bit = 0;
+    for (int n_unused = 0; ; bit++) {
+      if (!(used_ranks & (1 << bit))) {
+	if (n_unused == pos) {
+	  break;
+	}
+	n_unused++;
+      }
+    }
+    ranks |= (RankBitsT)(1 << bit);
+  }
+  return ranks;
+}
+
+// The suit configurations of each round.
+// A hand configuration is the four per-suit configs sorted in descending order and packed into a u64.
+// Each hand configuration has a contiguous range of indices.
+struct HoldemHandConfigsT {
+  std::vector<u64> keys[Normal::N_HOLDEM_ROUNDS];
+  // Offsets[i] is the first index of keys[i]; there is one extra entry for the total size
+  std::vector<u64> offsets[Normal::N_HOLDEM_ROUNDS];
+
+  HoldemHandConfigsT() {
+    for (int round = 0; round < Normal::N_HOLDEM_ROUNDS; round++) {
+      // All per-suit configs for this round
+      std::vector<u16> suit_configs = { 0 };
+      for (int r = 0; r <= round; r++) {
+	std::vector<u16> next_suit_configs;
+	for (u16 suit_config : suit_configs) {
+	  for (int n_cards = 0; n_cards <= Normal::HOLDEM_CARDS_PER_ROUND[r]; n_cards++) {
+	    next_suit_configs.push_back((u16)(suit_config | (n_cards << (4*(Normal::N_HOLDEM_ROUNDS-1 - r)))));
 	  }
+	}
+	suit_configs = next_suit_configs;
+      }
+      std::sort(suit_configs.begin(), suit_configs.end(), std::greater<u16>());
+
+      // Hand configs are descending sequences of four suit configs with the right number of cards in each round
+      const int n_suit_configs = (int)suit_configs.size();
+      for (int i0 = 0; i0 < n_suit_configs; i0++) {
+	for (int i1 = i0; i1 < n_suit_configs; i1++) {
+	  for (int i2 = i1; i2 < n_suit_configs; i2++) {
+	    for (int i3 = i2; i3 < n_suit_configs; i3++) {
+	      const u16 configs[NSuits] = { suit_configs[i0], suit_configs[i1], suit_configs[i2], suit_configs[i3] };
 
-	  OMAHA_HOLE_NORMAL_INDEX[c0][c1][c2][c3] = index;
+	      bool valid = true;
+	      for (int r = 0; r <= round; r++) {
+		int n_cards = 0;
+		for (int suit = 0; suit < NSuits; suit++) {
+		  n_cards += holdem_suit_config_count(configs[suit], r);
+		}
+		valid = valid && n_cards == Normal::HOLDEM_CARDS_PER_ROUND[r];
+	      }
+
+	      if (valid) {
+		keys[round].push_back(((u64)configs[0] << 48) | ((u64)configs[1] << 32) | ((u64)configs[2] << 16) | (u64)configs[3]);
+	      }
+	    }
+	  }
 	}
       }
+      std::sort(keys[round].begin(), keys[round].end());
+
+      u64 offset = 0;
+      for (u64 key : keys[round]) {
+	offsets[round].push_back(offset);
+	offset += size(key, round);
+      }
+      offsets[round].push_back(offset);
+
+      assert(offset == Normal::HOLDEM_HAND_INDEX_SIZES[round]);
+    }
+  }
+
+  static inline u16 suit_config(u64 key, int suit) {
+    return (u16)(key >> (16*(NSuits-1 - suit)));
+  }
+
+  // Number of hands with the given hand config - each run of equal suit configs is a multiset of suit indices
+  static u64 size(u64 key, int round) {
+    u64 size = 1;
+    for (int suit = 0; suit < NSuits; ) {
+      int n_equal = 1;
+      while (suit + n_equal < NSuits && suit_config(key, suit + n_equal) == suit_config(key, suit)) {
+	n_equal++;
+      }
+      size *= multichoose_u64(holdem_suit_config_size(suit_config(key, suit), round), n_equal);
+      suit += n_equal;
     }
+    return size;
   }
+};
 
-  assert(next_index == N_OMAHA_HOLE_NORMALS);
-  OMAHA_HOLE_NORMAL_INDEX_INITED = true;
+static const HoldemHandConfigsT& holdem_hand_configs() {
+  static const HoldemHandConfigsT configs;
+  return configs;
 }
 
-int Poker::Normal::omaha_hole_normal_index(CardT card0, CardT card1, CardT card2, CardT card3) {
-  assert(OMAHA_HOLE_NORMAL_INDEX_INITED);
+u64 Poker::Normal::holdem_hand_index_next_round(HoldemHandIndexStateT& state, const U8CardT* round_cards) {
+  const int round = state.round;
+  assert(0 <= round && round < N_HOLDEM_ROUNDS);
+
+  RankBitsT round_ranks[NSuits] = {};
+  for (int i = 0; i < HOLDEM_CARDS_PER_ROUND[round]; i++) {
+    round_ranks[round_cards[i].suit()] |= holdem_rank_bit(round_cards[i]);
+  }
+
+  // Per suit, (config, index) sorted descending
+  u64 suit_keys[NSuits];
+  for (int suit = 0; suit < NSuits; suit++) {
+    assert((round_ranks[suit] & state.used_ranks[suit]) == 0);
+
+    const int n_cards = Util::bitcount(round_ranks[suit]);
+    const int n_remaining = N_HOLDEM_RANKS - Util::bitcount(state.used_ranks[suit]);
+
+    state.suit_index[suit] = state.suit_index[suit]*small_choose(n_remaining, n_cards) + colex_rank_remaining(round_ranks[suit], state.used_ranks[suit]);
+    state.suit_config[suit] |= (u16)(n_cards << (4*(N_HOLDEM_ROUNDS-1 - round)));
+    state.used_ranks[suit] |= round_ranks[suit];
+
+    suit_keys[suit] = ((u64)state.suit_config[suit] << 48) | state.suit_index[suit];
+  }
+  state.round++;
 
-  u8 c0 = to_u8card(card0).u8_card;
-  u8 c1 = to_u8card(card1).u8_card;
-  u8 c2 = to_u8card(card2).u8_card;
-  u8 c3 = to_u8card(card3).u8_card;
+  Util::sort_desc(suit_keys[0], suit_keys[1]);
+  Util::sort_desc(suit_keys[2], suit_keys[3]);
+  Util::sort_desc(suit_keys[0], suit_keys[2]);
+  Util::sort_desc(suit_keys[1], suit_keys[3]);
+  Util::sort_desc(suit_keys[1], suit_keys[2]);
 
-  return OMAHA_HOLE_NORMAL_INDEX[c0][c1][c2][c3];
+  const u64 key = ((suit_keys[0] >> 48) << 48) | ((suit_keys[1] >> 48) << 32) | ((suit_keys[2] >> 48) << 16) | (suit_keys[3] >> 48);
+
+  const HoldemHandConfigsT& configs = holdem_hand_configs();
+  auto it = std::lower_bound(configs.keys[round].begin(), configs.keys[round].end(), key);
+  assert(it != configs.keys[round].end() && *it == key);
+  const u64 offset = configs.offsets[round][it - configs.keys[round].begin()];
+
+  // Mixed radix over runs of equal suit configs, each run a multiset of (descending) suit indices
+  u64 index = 0;
+  for (int suit = 0; suit < NSuits; ) {
+    const u16 suit_config = (u16)(suit_keys[suit] >> 48);
+    int n_equal = 1;
+    while (suit + n_equal < NSuits && (u16)(suit_keys[suit + n_equal] >> 48) == suit_config) {
+      n_equal++;
+    }
+
+    u64 multiset_rank = 0;
+    for (int i = 0; i < n_equal; i++) {
+      const u64 suit_index = suit_keys[suit + i] & (((u64)1 << 48) - 1);
+      multiset_rank += choose_u64(suit_index + n_equal-1 - i, n_equal - i);
+    }
+
+    index = index*multichoose_u64(holdem_suit_config_size(suit_config, round), n_equal) + multiset_rank;
+    suit += n_equal;
+  }
+
+  return offset + index;
 }
 
-std::tuple<CardT, CardT, CardT, CardT> Poker::Normal::omaha_hole_normal_from_index(int index) {
-  assert(OMAHA_HOLE_NORMAL_INDEX_INITED);
-  assert(0 <= index && (std::size_t)index < Poker::Normal::N_OMAHA_HOLE_NORMALS);
+u64 Poker::Normal::holdem_hand_index(int round, const U8CardT* cards) {
+  assert(0 <= round && round < N_HOLDEM_ROUNDS);
+
+  HoldemHandIndexStateT state;
+  u64 index = 0;
+  for (int r = 0; r <= round; r++) {
+    index = holdem_hand_index_next_round(state, cards + HOLDEM_CARDS_TO_ROUND[r] - HOLDEM_CARDS_PER_ROUND[r]);
+  }
+  return index;
+}
+
+void Poker::Normal::holdem_hand_index_all(const U8CardT cards[7], u64 indices[N_HOLDEM_ROUNDS]) {
+  HoldemHandIndexStateT state;
+  for (int r = 0; r < N_HOLDEM_ROUNDS; r++) {
+    indices[r] = holdem_hand_index_next_round(state, cards + HOLDEM_CARDS_TO_ROUND[r] - HOLDEM_CARDS_PER_ROUND[r]);
+  }
+}
+
+void Poker::Normal::holdem_hand_unindex(int round, u64 index, U8CardT* cards) {
+  assert(0 <= round && round < N_HOLDEM_ROUNDS);
+  assert(index < HOLDEM_HAND_INDEX_SIZES[round]);
+
+  const HoldemHandConfigsT& configs = holdem_hand_configs();
+  const std::size_t config_no = std::upper_bound(configs.offsets[round].begin(), configs.offsets[round].end(), index) - configs.offsets[round].begin() - 1;
+  const u64 key = configs.keys[round][config_no];
+  index -= configs.offsets[round][config_no];
 
-  return OMAHA_HOLE_NORMAL_FROM_INDEX[index];
+  // Runs of equal suit configs
+  int run_starts[NSuits];
+  int run_lens[NSuits];
+  int n_runs = 0;
+  for (int suit = 0; suit < NSuits; ) {
+    int n_equal = 1;
+    while (suit + n_equal < NSuits && HoldemHandConfigsT::suit_config(key, suit + n_equal) == HoldemHandConfigsT::suit_config(key, suit)) {
+      n_equal++;
+    }
+    run_starts[n_runs] = suit;
+    run_lens[n_runs] = n_equal;
+    n_runs++;
+    suit += n_equal;
+  }
+
+  // Unpick the mixed radix, last run first
+  u64 suit_index[NSuits];
+  for (int run = n_runs-1; run >= 0; run--) {
+    const int suit = run_starts[run];
+    const int n_equal = run_lens[run];
+    const u64 suit_size = holdem_suit_config_size(HoldemHandConfigsT::suit_config(key, suit), round);
+    const u64 run_size = multichoose_u64(suit_size, n_equal);
+
+    u64 multiset_rank = index % run_size;
+    index /= run_size;
+
+    for (int i = 0; i < n_equal; i++) {
+      const int k = n_equal - i;
+      // Largest x in [0, suit_size) with choose(x + k-1, k) <= multiset_rank
+      u64 lo = 0, hi = suit_size;
+      while (hi - lo > 1) {
+	u64 mid = lo + (hi - lo)/2;
+	if (choose_u64(mid + k-1, k) <= multiset_rank) {
+	  lo = mid;
+	} else {
+	  hi = mid;
+	}
+      }
+      suit_index[suit + i] = lo;
+      multiset_rank -= choose_u64(lo + k-1, k);
+    }
+  }
+
+  // Unpick each suit's rank sets, last round first, then deal them out round by round
+  int n_round_cards[N_HOLDEM_ROUNDS] = {};
+  for (int suit = 0; suit < NSuits; suit++) {
+    const u16 suit_config = HoldemHandConfigsT::suit_config(key, suit);
+
+    u64 round_ranks_rank[N_HOLDEM_ROUNDS] = {};
+    u64 remaining_index = suit_index[suit];
+    for (int r = round; r >= 0; r--) {
+      int n_remaining = N_HOLDEM_RANKS;
+      for (int r2 = 0; r2 < r; r2++) {
+	n_remaining -= holdem_suit_config_count(suit_config, r2);
+      }
+      const u64 n_sets = choose(n_remaining, holdem_suit_config_count(suit_config, r));
+      round_ranks_rank[r] = remaining_index % n_sets;
+      remaining_index /= n_sets;
+    }
+
+    RankBitsT used_ranks = 0;
+    for (int r = 0; r <= round; r++) {
+      RankBitsT ranks = colex_unrank_remaining(round_ranks_rank[r], holdem_suit_config_count(suit_config, r), used_ranks);
+      used_ranks |= ranks;
+
+      for (; ranks != 0; ranks &= ranks - 1) {
+	cards[HOLDEM_CARDS_TO_ROUND[r] - HOLDEM_CARDS_PER_ROUND[r] + n_round_cards[r]++] = holdem_card((SuitT)suit, __builtin_ctz(ranks));
+      }
+    }
+  }
 }
@@ -25,6 +25,69 @@ namespace Poker {
       return std::make_pair(norm_card0, norm_card1);
     }
 
+    // Texas Hold'em preflop hole card classes - 13 pocket pairs, 78 suited and 78 offsuit.
+    // Class ids are dense:
+    //   pocket pairs [0, 13) indexed by (aces-low) rank
+    //   suited [13, 91) and offsuit [91, 169) indexed by holdem_non_pair_index()
+    const std::size_t N_HOLDEM_HOLE_CLASSES = 169;
+    const std::size_t N_HOLDEM_NON_PAIR_CLASSES = 13*12/2;
+    const int HOLDEM_HOLE_CLASS_SUITED_OFFSET = 13;
+    const int HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET = HOLDEM_HOLE_CLASS_SUITED_OFFSET + (int)N_HOLDEM_NON_PAIR_CLASSES;
+    // Class id of a pair of identical cards
+    const u8 INVALID_HOLDEM_HOLE_CLASS = 0xff;
+
+    // Dense index of non-pair aces-low ranks - rank0 > rank1, both in [0, 13)
+    static constexpr inline int holdem_non_pair_index(int rank0, int rank1) {
+      return (int)N_HOLDEM_NON_PAIR_CLASSES - (rank0+1)*rank0/2 + rank1;
+    }
+
+    // @param rank0, rank1 - aces-low or aces-high, in any order
+    static constexpr inline int holdem_hole_class(RankT rank0, RankT rank1, bool is_suited) {
+      int r0 = to_ace_low(rank0);
+      int r1 = to_ace_low(rank1);
+      if (r0 == r1) {
+	return r0;
+      }
+      if (r0 < r1) {
+	int tmp = r0; r0 = r1; r1 = tmp;
+      }
+      return (is_suited ? HOLDEM_HOLE_CLASS_SUITED_OFFSET : HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET) + holdem_non_pair_index(r0, r1);
+    }
+
+    // Hole card class of every pair of U8CardT's
+    struct HoldemHoleClassTableT {
+      u8 hole_class[52][52];
+
+      constexpr HoldemHoleClassTableT(): hole_class() {
+	for (int c0 = 0; c0 < 52; c0++) {
+	  for (int c1 = 0; c1 < 52; c1++) {
+	    hole_class[c0][c1] = c0 == c1 ? INVALID_HOLDEM_HOLE_CLASS : (u8)holdem_hole_class((RankT)(c0 >> 2), (RankT)(c1 >> 2), (c0 & 0x3) == (c1 & 0x3));
+	  }
+	}
+      }
+    };
+
+    inline constexpr HoldemHoleClassTableT HOLDEM_HOLE_CLASS_TABLE = HoldemHoleClassTableT();
+
+    // @return class id in [0, N_HOLDEM_HOLE_CLASSES) by table lookup
+    inline int holdem_hole_class(U8CardT card0, U8CardT card1) {
+      return HOLDEM_HOLE_CLASS_TABLE.hole_class[card0.u8_card][card1.u8_card];
+    }
+
+    inline int holdem_hole_class(CardT card0, CardT card1) {
+      return holdem_hole_class(to_u8card(card0), to_u8card(card1));
+    }
+
+    // Number of hole card combos in each class - 6 for pocket pairs, 4 suited, 12 offsuit
+    static constexpr inline int holdem_hole_class_n_combos(int hole_class) {
+      return hole_class < HOLDEM_HOLE_CLASS_SUITED_OFFSET ? 6 : hole_class < HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET ? 4 : 12;
+    }
+
+    static_assert(HOLDEM_HOLE_CLASS_TABLE.hole_class[AceLow << 2 | Spades][AceLow << 2 | Hearts] == AceLow);
+    static_assert(HOLDEM_HOLE_CLASS_TABLE.hole_class[AceLow << 2 | Spades][King << 2 | Spades] == HOLDEM_HOLE_CLASS_SUITED_OFFSET + 0);
+    static_assert(HOLDEM_HOLE_CLASS_TABLE.hole_class[Two << 2 | Spades][AceLow << 2 | Hearts] == HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET + 77);
+    static_assert(HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET + (int)N_HOLDEM_NON_PAIR_CLASSES == (int)N_HOLDEM_HOLE_CLASSES);
+
     inline HandT flop_to_hand(std::tuple<CardT, CardT, CardT> flop) {
       const CardT cards[3] = { std::get<0>(flop), std::get<1>(flop), std::get<2>(flop) };
       return mkHand(cards, 3);
@@ -45,62 +108,45 @@ namespace Poker {
       }
     }
 
-#ifdef INCOMPLETE_TODO
-
-    // $#$%#$% should be flop_normal
-    
-    // Normalised Texas Hold'em flop, for suited hole cards
-    inline std::tuple<CardT, CardT, CardT> holdem_hole_normal_suited(SuitT suit, std::tuple<CardT, CardT, CardT> flop) {
-      HandT flop_hand = flop_to_hand(flop);
-
-      // Cards with same suit as hole cards
-      RankBitsT hole_suit_ranks = flop_hand.suits[suit];
-
-      // Remove hole suit cards from the flop hand
-      flop_hand.suits[suit] = 0;
-
-      // Sort the flop suits by rank bits in descending order
-      std::sort(flop_hand.suits, flop_hand.suits + NSuits, std::greater<>());
-
-      CardT flop_norm[3];
-      std::size_t flop_norm_index = 0;
-
-      add_cards(Spades, hole_suit_ranks, flop_norm_index, flop_norm, 3);
-      add_cards(Hearts, flop_hand.suits[0], flop_norm_index, flop_norm, 3);
-      add_cards(Diamonds, flop_hand.suits[1], flop_norm_index, flop_norm, 3);
-      add_cards(Clubs, flop_hand.suits[2], flop_norm_index, flop_norm, 3);
-
-      assert(flop_norm_index == 3);
-
-      return std::make_tuple(flop_norm[0], flop_norm[1], flop_norm[2]);
-    }
-  
-    // Normalised Texas Hold'em flop, for pocket-pair hole cards
-    inline std::tuple<CardT, CardT, CardT> holdem_hole_normal_pocket_pair(SuitT suit0, SuitT suit1, std::tuple<CardT, CardT, CardT> flop) {
-      HandT flop_hand = flop_to_hand(flop);
-      // #$%#$%
-    }
-  
-    // Normalised Texas Hold'em flop, for off-suit non-pocket-pair hole cards
-    inline std::tuple<CardT, CardT, CardT> holdem_hole_normal_offsuit(CardT card0, CardT card1, std::tuple<CardT, CardT, CardT> flop) {
-      HandT flop_hand = flop_to_hand(flop);
-      // #$%#$%
-    }
-  
-    // Normalised Texas Hold'em flop, relative to the hole cards
-    inline std::tuple<CardT, CardT, CardT> holdem_hole_normal(CardT card0, CardT card1, std::tuple<CardT, CardT, CardT> flop) {
-      RankT rank0 = to_ace_hi(card0.rank);
-      RankT rank1 = to_ace_hi(card1.rank);
-
-      if(card0.suit == card1.suit) {
-	return holdem_hole_normal_suited(card0.suit, flop);
-      } else if(rank0 == rank1) {
-	return holdem_hole_normal_pocket_pair(card0.suit, card1.suit, flop);
-      } else {
-	return holdem_hole_normal_offsuit(card0, card1, flop);
-      }
-    }
-#endif // INCOMPLETE_TODO
+    // Texas Hold'em hand isomorphism - hole cards plus the board up to a given round.
+    // Hands which are identical up to relabelling of suits, and ordering of cards within a round,
+    //   map to the same dense index in [0, HOLDEM_HAND_INDEX_SIZES[round]).
+    // Round 0 is preflop (hole cards only), 1 is the flop, 2 the turn and 3 the river.
+    const int N_HOLDEM_ROUNDS = 4;
+    const int HOLDEM_CARDS_PER_ROUND[N_HOLDEM_ROUNDS] = { 2, 3, 1, 1 };
+    // Total cards dealt up to and including each round
+    const int HOLDEM_CARDS_TO_ROUND[N_HOLDEM_ROUNDS] = { 2, 5, 6, 7 };
+    const u64 HOLDEM_HAND_INDEX_SIZES[N_HOLDEM_ROUNDS] = { 169, 1286792, 55190538, 2428287420 };
+
+    // Incremental indexing state - add each round's cards in turn, e.g. flop then turn then river of the same deal.
+    struct HoldemHandIndexStateT {
+      // Next round to be added
+      int round;
+      // Ranks (aces-high, bit 0 is Two) used so far per suit
+      RankBitsT used_ranks[NSuits];
+      // Per-suit number of cards in each round, 4 bits per round with round 0 in the high nibble
+      u16 suit_config[NSuits];
+      // Per-suit index of the suit's rank sets within the suit config
+      u64 suit_index[NSuits];
+
+      HoldemHandIndexStateT():
+	round(0), used_ranks(), suit_config(), suit_index() {}
+    };
+
+    // Add the next round's cards - HOLDEM_CARDS_PER_ROUND[state.round] of them.
+    // @return index of the hand up to and including this round
+    extern u64 holdem_hand_index_next_round(HoldemHandIndexStateT& state, const U8CardT* round_cards);
+
+    // @param cards - hole cards then board cards - HOLDEM_CARDS_TO_ROUND[round] of them
+    // @return index of the hand up to and including the given round
+    extern u64 holdem_hand_index(int round, const U8CardT* cards);
+
+    // Indices of all four rounds of a full deal - hole cards then board cards.
+    extern void holdem_hand_index_all(const U8CardT cards[7], u64 indices[N_HOLDEM_ROUNDS]);
+
+    // Canonical hand for the given index - HOLDEM_CARDS_TO_ROUND[round] cards, hole cards first.
+    // holdem_hand_index(round, cards) returns index again.
+    extern void holdem_hand_unindex(int round, u64 index, U8CardT* cards);
 
     // Normalised Omaha hand.
     // Four cards - we sort the suits by bitmap (aces-high) and then map back to CardT's
@@ -128,14 +174,16 @@ namespace Poker {
       return std::make_tuple(norm_cards[0], norm_cards[1], norm_cards[2], norm_cards[3]);
     }
 
-    // Determined empirically
+    // 715 + 3,718 + 3,081 + 7,098 + 1,820 for suit patterns 4, 3-1, 2-2, 2-1-1 and 1-1-1-1
     const std::size_t N_OMAHA_HOLE_NORMALS = 16432;
     // Index for invalid hold card sets (due to duplicates)
     const int INVALID_OMAHA_HOLE_NORMAL_INDEX = -1;
 
-    // Call before using omaha_hole_normal_index() or omaha_hole_normal_from_index()
-    extern void init_omaha_hole_normal_index();
-    // @return index in [0, N_OMAHA_HOLE_NORMALS) of normalised Omaha hole cards
+    // Optional - map (or generate and persist) the table backing omaha_hole_normal_from_index() up front
+    //   rather than on first use.
+    extern void load_omaha_hole_normal_from_index_table();
+    // Computed directly from the per-suit rank bitmaps - no table lookup.
+    // @return index in [0, N_OMAHA_HOLE_NORMALS) of normalised Omaha hole cards, or INVALID_OMAHA_HOLE_NORMAL_INDEX for duplicate cards
     extern int omaha_hole_normal_index(CardT card0, CardT card1, CardT card2, CardT card3);
     // @return normalised Omaha hole cards for given index in [0, N_OMAHA_HOLE_NORMALS)
     extern std::tuple<CardT, CardT, CardT, CardT> omaha_hole_normal_from_index(int index);
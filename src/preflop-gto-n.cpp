@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "dealer.hpp"
+#include "flop-category.hpp"
+#include "gto-runtime-tree.hpp"
+#include "gto-strategy.hpp"
+#include "hand-eval.hpp"
+#include "normal.hpp"
+#include "types.hpp"
+
+using namespace Poker;
+using namespace Poker::Gto;
+
+// N-player limit hold-em preflop solver on the runtime game tree - see gto-runtime-tree.hpp.
+// Optionally with a flop betting round played per flop category - see flop-category.hpp - or per adaptive
+//   clump of flop categories - see gto-deal-clumps.hpp.
+// Heads-up preflop-only is better served by preflop-gto, which has exact equity and exploitability.
+
+// Deal one hand to every player
+static void deal_hand(Dealer::DealerT& dealer, int n_players, bool has_flop, LimitRuntimeDealT& deal) {
+  U8CardT cards[2*LIMIT_RUNTIME_MAX_PLAYERS + 5];
+  dealer.deal(cards, 2*n_players + 5);
+
+  const U8CardT* board = &cards[2*n_players];
+  auto flop = std::make_tuple(CardT(board[0]), CardT(board[1]), CardT(board[2]));
+  auto turn = CardT(board[3]);
+  auto river = CardT(board[4]);
+
+  for(int n = 0; n < n_players; n++) {
+    auto hole = std::make_pair(CardT(cards[2*n + 0]), CardT(cards[2*n + 1]));
+    deal.hole_classes[n] = Normal::holdem_hole_class(cards[2*n + 0], cards[2*n + 1]);
+    if(has_flop) {
+      deal.flop_categories[n] = FlopCategory::holdem_flop_category(cards[2*n + 0], cards[2*n + 1], board[0], board[1], board[2]);
+    }
+    deal.hand_evals[n] = HandEval::eval_hand_holdem(hole, flop, turn, river);
+  }
+}
+
+// One round of external-sampling MCCFR - every player traverses every deal.
+// @param player_profits is the mean sampled profit of each player with the current strategies
+// @param deal_clumps is nullptr unless flop categories are clumped
+template <typename StorageT>
+static void evaluate_round(const LimitRuntimeTreeT& tree, Dealer::DealerT& dealer, int n_deals, const LimitRuntimeStrategiesT<StorageT>& strategies, LimitRuntimeEvalsT<StorageT>& evals, LimitRuntimeDealClumpsT* deal_clumps, double player_profits[]) {
+  reset_limit_runtime_evals(tree, n_deals, evals);
+
+  LimitRuntimeDealT deal;
+
+  for(int n = 0; n < tree.n_players; n++) {
+    player_profits[n] = 0.0;
+  }
+
+  for(int i = 0; i < n_deals; i++) {
+    deal_hand(dealer, tree.n_players, tree.has_flop, deal);
+    for(int traverser_no = 0; traverser_no < tree.n_players; traverser_no++) {
+      player_profits[traverser_no] += sample_limit_runtime_hand(tree, /*root*/0, traverser_no, deal, strategies, evals, dealer.rng, deal_clumps);
+    }
+  }
+
+  for(int n = 0; n < tree.n_players; n++) {
+    player_profits[n] /= n_deals;
+  }
+}
+
+// Raise probability of the player first to act, by hole class - suited top right, offsuit bottom left
+template <typename StorageT>
+static void dump_first_to_act_strategy(const LimitRuntimeTreeT& tree, const LimitRuntimeStrategiesT<StorageT>& strategies) {
+  const LimitRuntimeNodeT& root = tree.nodes[0];
+  printf("P%d (first to act) raise %%\n\n    ", root.player_no);
+  for(int rank2 = Ace; rank2 > AceLow; rank2--) {
+    printf("   %c ", RANK_CHARS[rank2]);
+  }
+  printf("\n");
+  for(int rank1 = Ace; rank1 > AceLow; rank1--) {
+    printf("  %c ", RANK_CHARS[rank1]);
+    for(int rank2 = Ace; rank2 > AceLow; rank2--) {
+      const int hole_class = Normal::holdem_hole_class((RankT)rank1, (RankT)rank2, /*is_suited*/rank2 < rank1);
+      printf(" %3.0f ", strategies.get(hole_class, root.decision_no).get_p(ActionRaise)*100.0);
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+// Bet probability of the first player to act on the flop after every preflop call, by flop category.
+// Categories that never came up are skipped.
+template <typename StorageT>
+static void dump_first_flop_strategy(const LimitRuntimeTreeT& tree, const LimitRuntimeStrategiesT<StorageT>& strategies, const LimitRuntimeEvalsT<StorageT>& evals) {
+  int flop_deal = 0;
+  while(flop_deal < tree.n_nodes() && tree.nodes[flop_deal].node_type != FlopDealNodeType) {
+    flop_deal++;
+  }
+  if(flop_deal == tree.n_nodes()) {
+    return;
+  }
+  const LimitRuntimeNodeT& first = tree.nodes[tree.nodes[flop_deal].children[ActionCall]];
+  printf("P%d (first to act on the flop after preflop calls) bet %%\n\n", first.player_no);
+  for(int category = 0; category < FlopCategory::N_FLOP_CATEGORIES; category++) {
+    if(evals.get(category, first.decision_no).activity == 0) {
+      continue;
+    }
+    printf("  %-48s %3.0f\n", FlopCategory::flop_category_name(category).c_str(), strategies.get(category, first.decision_no).get_p(ActionRaise)*100.0);
+  }
+  printf("\n");
+}
+
+// Clumps of the first flop deal node after every preflop call, by EV, with how many flop categories that
+//   came up are in each and the bet probability of the first player to act on the flop
+template <typename StorageT>
+static void dump_first_flop_clumps(const LimitRuntimeTreeT& tree, const LimitRuntimeStrategiesT<StorageT>& strategies, const LimitRuntimeDealClumpsT& deal_clumps) {
+  int flop_deal = 0;
+  while(flop_deal < tree.n_nodes() && tree.nodes[flop_deal].node_type != FlopDealNodeType) {
+    flop_deal++;
+  }
+  if(flop_deal == tree.n_nodes()) {
+    return;
+  }
+  const DealClumpsT& clumps = deal_clumps[tree.nodes[flop_deal].deal_no];
+  const LimitRuntimeNodeT& first = tree.nodes[tree.nodes[flop_deal].children[ActionCall]];
+  printf("%d flop clumps - P%d (first to act on the flop after preflop calls) bet %%\n\n", clumps.n_clumps(), first.player_no);
+
+  std::vector<int> by_ev;
+  for(int clump = 0; clump < clumps.n_clumps(); clump++) {
+    by_ev.push_back(clump);
+  }
+  std::sort(by_ev.begin(), by_ev.end(), [&](int a, int b) { return clumps.clumps[a].lower_ev < clumps.clumps[b].lower_ev; });
+
+  for(int clump : by_ev) {
+    int n_combos = 0;
+    for(int category = 0; category < FlopCategory::N_FLOP_CATEGORIES; category++) {
+      n_combos += clumps.get_clump(category) == clump && clumps.combo_activity[category] != 0.0 ? 1 : 0;
+    }
+    printf("  EV [%8.3f, %8.3f) %3d categories %3.0f\n", clumps.clumps[clump].lower_ev, clumps.clumps[clump].upper_ev, n_combos, strategies.get(clump, first.decision_no).get_p(ActionRaise)*100.0);
+  }
+  printf("\n");
+}
+
+enum RuntimeStorageT { DoubleStorage, FloatStorage, FixedStorage };
+
+// Memory of the per information set strategies and evals, and of the tree itself
+template <typename StorageT>
+static double get_solver_mb(const LimitRuntimeTreeT& tree) {
+  const size_t n_infosets = (size_t)tree.n_classes() * tree.n_decisions;
+  return (double)(tree.n_nodes()*sizeof(LimitRuntimeNodeT) + n_infosets*(sizeof(LimitRuntimeStrategyT<StorageT>) + sizeof(LimitRuntimeEvalT<StorageT>)))/(1024.0*1024.0);
+}
+
+static double get_solver_mb(const LimitRuntimeTreeT& tree, RuntimeStorageT storage) {
+  switch(storage) {
+  case FloatStorage:
+    return get_solver_mb<FloatRuntimeStorage>(tree);
+  case FixedStorage:
+    return get_solver_mb<FixedRuntimeStorage>(tree);
+  default:
+    return get_solver_mb<DoubleRuntimeStorage>(tree);
+  }
+}
+
+static double get_physical_memory_mb() {
+  return (double)sysconf(_SC_PHYS_PAGES) * (double)sysconf(_SC_PAGE_SIZE)/(1024.0*1024.0);
+}
+
+// Solve with external-sampling MCCFR and dump the average strategies
+template <typename StorageT>
+static void solve(const LimitRuntimeTreeT& tree, int n_rounds, int n_deals, StrategyAdjustT adjust, bool is_clumped, double split_activity) {
+  // Allocate on heap, not stack cos these are large
+  LimitRuntimeStrategiesT<StorageT> strategies(tree);
+  init_limit_runtime_strategies(tree, strategies);
+  LimitRuntimeEvalsT<StorageT> evals(tree);
+  LimitRuntimeDealClumpsT deal_clumps = make_limit_runtime_deal_clumps(tree);
+
+  std::seed_seq seed{1, 2, 3, 4, 6};
+  Dealer::DealerT dealer(seed);
+
+  for(int round = 0; round < n_rounds; round++) {
+    const auto start = std::chrono::steady_clock::now();
+
+    double player_profits[LIMIT_RUNTIME_MAX_PLAYERS];
+    evaluate_round(tree, dealer, n_deals, strategies, evals, (is_clumped ? &deal_clumps : nullptr), player_profits);
+
+    const StrategyAdjustPolicyT policy = { adjust, /*leeway*/0.0, /*min_strategy*/0.0, NoClamp, /*cfr_iteration*/round+1 };
+    adjust_limit_runtime_strategies(tree, strategies, evals, policy);
+
+    const int n_splits = is_clumped ? adjust_limit_runtime_deal_clumps(tree, strategies, deal_clumps, split_activity) : 0;
+
+    const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    printf("Round %4d:", round);
+    for(int n = 0; n < tree.n_players; n++) {
+      printf(" P%d %8.5f", n, player_profits[n]);
+    }
+    if(is_clumped) {
+      printf(" - %d clumps split", n_splits);
+    }
+    printf(" - %.2fs\n", secs.count());
+  }
+
+  // The average strategy is what converges
+  const StrategyAdjustPolicyT policy = { AdjustToAverage, /*leeway*/0.0, /*min_strategy*/0.0, NoClamp, /*cfr_iteration*/0 };
+  adjust_limit_runtime_strategies(tree, strategies, evals, policy);
+
+  printf("\n");
+  dump_first_to_act_strategy(tree, strategies);
+  if(is_clumped) {
+    dump_first_flop_clumps(tree, strategies, deal_clumps);
+  } else if(tree.has_flop) {
+    dump_first_flop_strategy(tree, strategies, evals);
+  }
+}
+
+static bool is_number(const std::string& arg) {
+  return !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c) { return '0' <= c && c <= '9'; });
+}
+
+static const char* USAGE = "Usage: preflop-gto-n [<n-players>] [raises <n>] [rounds <n>] [deals <n>] [cfr+|dcfr] [float|fixed] [flop] [flop-raises <n>] [clumps <max>] [split <activity>]\n";
+
+int main(int argc, char* argv[]) {
+  int n_players = 6;
+  int n_raises = 3;
+  bool is_n_raises_set = false;
+  int N_ROUNDS = 64;
+  int N_DEALS = 100000;
+  StrategyAdjustT adjust = AdjustDcfr;
+  RuntimeStorageT storage = DoubleStorage;
+  bool has_flop = false;
+  int n_flop_raises = 3;
+  int max_flop_clumps = 0;
+  double split_activity = 1000.0;
+
+  for(int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "raises" && i+1 < argc) {
+      n_raises = std::atoi(argv[++i]);
+      is_n_raises_set = true;
+    } else if(arg == "rounds" && i+1 < argc) {
+      N_ROUNDS = std::atoi(argv[++i]);
+    } else if(arg == "deals" && i+1 < argc) {
+      N_DEALS = std::atoi(argv[++i]);
+    } else if(arg == "cfr+") {
+      adjust = AdjustCfrPlus;
+    } else if(arg == "dcfr") {
+      adjust = AdjustDcfr;
+    } else if(arg == "float") {
+      storage = FloatStorage;
+    } else if(arg == "fixed") {
+      storage = FixedStorage;
+    } else if(arg == "flop") {
+      has_flop = true;
+    } else if(arg == "flop-raises" && i+1 < argc) {
+      has_flop = true;
+      n_flop_raises = std::atoi(argv[++i]);
+    } else if(arg == "clumps" && i+1 < argc) {
+      has_flop = true;
+      max_flop_clumps = std::atoi(argv[++i]);
+    } else if(arg == "split" && i+1 < argc) {
+      split_activity = std::atof(argv[++i]);
+    } else if(is_number(arg)) {
+      n_players = std::atoi(argv[i]);
+    } else {
+      fprintf(stderr, "preflop-gto-n: unknown argument '%s'\n%s", argv[i], USAGE);
+      return 1;
+    }
+  }
+
+  if(n_players < 2 || n_players > LIMIT_RUNTIME_MAX_PLAYERS) {
+    fprintf(stderr, "preflop-gto-n: between 2 and %d players\n", LIMIT_RUNTIME_MAX_PLAYERS);
+    return 1;
+  }
+
+  // The per information set state grows about 6 times per player at 3 raises - 9 players would need over 100GB.
+  // Without an explicit raise cap we take the most raises - up to the default - that fit in memory.
+  const double memory_mb = get_physical_memory_mb();
+  LimitRuntimeTreeT tree = make_limit_runtime_tree(n_players, n_raises, /*small_blind*/1, /*big_blind*/2, has_flop, n_flop_raises, max_flop_clumps);
+  while(!is_n_raises_set && n_raises > 1 && get_solver_mb(tree, storage) > memory_mb) {
+    printf("%d players, %d raises needs %.1fMB but there's %.1fMB - trying %d raises\n", n_players, n_raises, get_solver_mb(tree, storage), memory_mb, n_raises-1);
+    n_raises--;
+    tree = make_limit_runtime_tree(n_players, n_raises, /*small_blind*/1, /*big_blind*/2, has_flop, n_flop_raises, max_flop_clumps);
+  }
+
+  const size_t n_infosets = (size_t)tree.n_classes() * tree.n_decisions;
+  printf("%d players, %d raises%s: %d nodes, %d decision nodes, %zu information sets, %.1fMB\n", n_players, n_raises, (has_flop ? " with flop" : ""), tree.n_nodes(), tree.n_decisions, n_infosets, get_solver_mb(tree, storage));
+
+  if(get_solver_mb(tree, storage) > memory_mb) {
+    fprintf(stderr, "preflop-gto-n: %d players, %d raises needs %.1fMB but there's %.1fMB - use fewer raises with 'raises <n>'\n", n_players, n_raises, get_solver_mb(tree, storage), memory_mb);
+    return 1;
+  }
+
+  const bool is_clumped = has_flop && max_flop_clumps > 0;
+  switch(storage) {
+  case FloatStorage:
+    solve<FloatRuntimeStorage>(tree, N_ROUNDS, N_DEALS, adjust, is_clumped, split_activity);
+    break;
+  case FixedStorage:
+    solve<FixedRuntimeStorage>(tree, N_ROUNDS, N_DEALS, adjust, is_clumped, split_activity);
+    break;
+  default:
+    solve<DoubleRuntimeStorage>(tree, N_ROUNDS, N_DEALS, adjust, is_clumped, split_activity);
+    break;
+  }
+
+  return 0;
+}
@@ -1,46 +1,82 @@
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "dealer.hpp"
+#include "gto-best-response.hpp"
+#include "gto-checkpoint.hpp"
 #include "gto-eval.hpp"
+#include "gto-flat.hpp"
+#include "gto-lookup.hpp"
+#include "gto-metrics.hpp"
 #include "gto-strategy.hpp"
+#include "gto-warm-start.hpp"
 #include "hand-eval.hpp"
+#include "holdem-equity.hpp"
 #include "normal.hpp"
 #include "types.hpp"
 
 using namespace Poker;
 using namespace Poker::Gto;
 
-typedef typename LimitRootHandStrategy<2>::type_t LimitRootTwoHandStrategy;
+// The solved tree - build with e.g. -DPREFLOP_GTO_N_RAISES=2 for other trees, see Makefile
+#ifndef PREFLOP_GTO_N_RAISES
+#define PREFLOP_GTO_N_RAISES 3
+#endif
+#ifndef PREFLOP_GTO_SMALL_BLIND
+#define PREFLOP_GTO_SMALL_BLIND 1
+#endif
+#ifndef PREFLOP_GTO_BIG_BLIND
+#define PREFLOP_GTO_BIG_BLIND 2
+#endif
+
+static_assert(PREFLOP_GTO_N_RAISES >= 2, "strategy dumps need at least 2 raises");
+
+typedef typename LimitRootHandStrategy<2, PREFLOP_GTO_N_RAISES, PREFLOP_GTO_SMALL_BLIND, PREFLOP_GTO_BIG_BLIND>::type_t LimitRootTwoHandStrategy;
 typedef PerHoleHandContainer<LimitRootTwoHandStrategy> LimitRootTwoHandHoleHandStrategies;
-typedef typename LimitRootHandEval<2>::type_t LimitRootTwoHandEval;
+typedef typename LimitRootHandEval<2, PREFLOP_GTO_N_RAISES, PREFLOP_GTO_SMALL_BLIND, PREFLOP_GTO_BIG_BLIND>::type_t LimitRootTwoHandEval;
 typedef PerHoleHandContainer<LimitRootTwoHandEval> LimitRootTwoHandHoleHandEvals;
 
 typedef GtoStrategy</*CAN_RAISE*/true> FoldCallRaiseStrategy;
 typedef GtoStrategy</*CAN_RAISE*/false> FoldCallStrategy;
 
-static void dump_fold_call_raise_strategy(const FoldCallRaiseStrategy& strategy) {
+static void dump_strategy(const FoldCallRaiseStrategy& strategy) {
   printf("fold  %.4f / call  %.4f / raise %.4f", strategy.fold_p, strategy.call_p, strategy.raise_p);
 }
 
-static void dump_fold_call_strategy(const FoldCallStrategy& strategy) {
+[[maybe_unused]]
+static void dump_strategy(const FoldCallStrategy& strategy) {
   printf("fold  %.4f / call  %.4f", strategy.fold_p, strategy.call_p);
 }
 
-static void dump_p0_hand_strategy(int rank1, int rank2, bool suited, const LimitRootTwoHandStrategy& hand_strategy) {
+// Lines that are past the raise cap are left out
+template <typename RootStrategyT>
+static void dump_p0_hand_strategy(int rank1, int rank2, bool suited, const RootStrategyT& hand_strategy) {
   printf("P0 %c%c%c\n", RANK_CHARS[rank1], RANK_CHARS[rank2], (suited ? 's' : 'o'));
-  printf("  open:                   "); dump_fold_call_raise_strategy(hand_strategy.strategy); printf("\n");
-  printf("  call-raise:             "); dump_fold_call_raise_strategy(hand_strategy.call.raise.strategy); printf("\n");
-  printf("  call-raise-raise-raise: "); dump_fold_call_strategy(hand_strategy.call.raise.raise.raise.strategy); printf("\n");
-  printf("  raise-raise:            "); dump_fold_call_raise_strategy(hand_strategy.raise.raise.strategy); printf("\n");
+  printf("  open:                   "); dump_strategy(hand_strategy.strategy); printf("\n");
+  printf("  call-raise:             "); dump_strategy(hand_strategy.call.raise.strategy); printf("\n");
+  if constexpr(RootStrategyT::n_raises_left >= 3) {
+    printf("  call-raise-raise-raise: "); dump_strategy(hand_strategy.call.raise.raise.raise.strategy); printf("\n");
+  }
+  printf("  raise-raise:            "); dump_strategy(hand_strategy.raise.raise.strategy); printf("\n");
 }
 
-static void dump_p1_hand_strategy(int rank1, int rank2, bool suited, const LimitRootTwoHandStrategy& hand_strategy) {
+template <typename RootStrategyT>
+static void dump_p1_hand_strategy(int rank1, int rank2, bool suited, const RootStrategyT& hand_strategy) {
   printf("P1 %c%c%c\n", RANK_CHARS[rank1], RANK_CHARS[rank2], (suited ? 's' : 'o'));
-  printf("  call:                   "); dump_fold_call_raise_strategy(hand_strategy.call.strategy); printf("\n");
-  printf("  call-raise-raise:       "); dump_fold_call_raise_strategy(hand_strategy.call.raise.raise.strategy); printf("\n");
-  printf("  raise:                  "); dump_fold_call_raise_strategy(hand_strategy.raise.strategy); printf("\n");
-  printf("  raise-raise-raise:      "); dump_fold_call_strategy(hand_strategy.raise.raise.raise.strategy); printf("\n");
+  printf("  call:                   "); dump_strategy(hand_strategy.call.strategy); printf("\n");
+  printf("  call-raise-raise:       "); dump_strategy(hand_strategy.call.raise.raise.strategy); printf("\n");
+  printf("  raise:                  "); dump_strategy(hand_strategy.raise.strategy); printf("\n");
+  if constexpr(RootStrategyT::n_raises_left >= 3) {
+    printf("  raise-raise-raise:      "); dump_strategy(hand_strategy.raise.raise.raise.strategy); printf("\n");
+  }
 }
 
 static void dump_p0_strategy(LimitRootTwoHandHoleHandStrategies& player_strategies) {
@@ -120,7 +156,7 @@ static void dump_player_strategy(bool is_p0, const LimitRootTwoHandHoleHandStrat
   for(RankT rank = Ace; rank > AceLow; rank = (RankT)(rank-1)) {
     int rank1 = rank == Ace ? AceLow : rank;
 
-    dump_p0_hand_strategy(rank1, rank1, suited, strategies.pocket_pairs[rank1]);
+    dump_p0_hand_strategy(rank1, rank1, suited, strategies.get_class_value(rank1));
   }
   
   printf("\n\n");
@@ -135,7 +171,7 @@ static void dump_player_strategy(bool is_p0, const LimitRootTwoHandHoleHandStrat
 
       size_t r0 = rank1 == Ace ? rank2 : rank1;
       size_t r1 = rank1 == Ace ? AceLow : rank2;
-      dump_p0_hand_strategy(rank1, rank2, suited, strategies.suited[LimitRootTwoHandHoleHandStrategies::get_non_pair_index(r0, r1)]);
+      dump_p0_hand_strategy(rank1, rank2, suited, strategies.get_class_value(Normal::HOLDEM_HOLE_CLASS_SUITED_OFFSET + Normal::holdem_non_pair_index(r0, r1)));
     }
 
     printf("\n");
@@ -153,7 +189,7 @@ static void dump_player_strategy(bool is_p0, const LimitRootTwoHandHoleHandStrat
   
       size_t r0 = rank1 == Ace ? rank2 : rank1;
       size_t r1 = rank1 == Ace ? AceLow : rank2;
-      dump_p0_hand_strategy(rank1, rank2, suited, strategies.offsuit[LimitRootTwoHandHoleHandStrategies::get_non_pair_index(r0, r1)]);
+      dump_p0_hand_strategy(rank1, rank2, suited, strategies.get_class_value(Normal::HOLDEM_HOLE_CLASS_OFFSUIT_OFFSET + Normal::holdem_non_pair_index(r0, r1)));
     }
 
     printf("\n");
@@ -207,143 +243,695 @@ static void adjust_strategies(LimitRootTwoHandStrategy& strategy, /*const*/ Limi
   player_evals.evals[0] = &p0_hand_eval;
   player_evals.evals[1] = &p1_hand_eval;
 
-  strategy.adjust(player_evals, policy, stats);
+  strategy.adjust(player_evals, make_root_reach<2>(1.0), policy, stats);
 }
 			       
 static void adjust_strategies(LimitRootTwoHandHoleHandStrategies& player_strategies, /*const*/ LimitRootTwoHandHoleHandEvals& p0_eval, /*const*/ LimitRootTwoHandHoleHandEvals& p1_eval, const StrategyAdjustPolicyT& policy, StrategyAdjustStatsT& stats) {
 
-  // Pocket pairs
-  for(RankT rank = Ace; rank > AceLow; rank = (RankT)(rank-1)) {
-    adjust_strategies(player_strategies.get_pocket_pair_value(rank), p0_eval.get_pocket_pair_value(rank), p1_eval.get_pocket_pair_value(rank), policy, stats);
+  for(int hole_class = 0; hole_class < (int)Normal::N_HOLDEM_HOLE_CLASSES; hole_class++) {
+    adjust_strategies(player_strategies.get_class_value(hole_class), p0_eval.get_class_value(hole_class), p1_eval.get_class_value(hole_class), policy, stats);
   }
-  
-  // Suited
-  for(RankT rank_hi = Ace; rank_hi > AceLow; rank_hi = (RankT)(rank_hi-1)) {
-    for(RankT rank_lo = (RankT)(rank_hi-1); rank_lo > AceLow; rank_lo = (RankT)(rank_lo-1)) {
-      adjust_strategies(player_strategies.get_offsuit_value(rank_hi, rank_lo), p0_eval.get_offsuit_value(rank_hi, rank_lo), p1_eval.get_offsuit_value(rank_hi, rank_lo), policy, stats);
+}
+
+// Storage of the flat evaluation arrays - see the storage policies in gto-flat.hpp
+enum FlatStorageT { DoubleStorage, FloatStorage, FixedStorage };
+
+// Dealing in batches until the strategy-relevant action values are statistically resolved, rather
+//   than dealing a fixed number of deals - see evaluate_deals_adaptive()
+struct AdaptiveDealConfigT {
+  bool is_adaptive;
+  int batch_n_deals;
+  // The values of two actions are resolved if the standard error of their difference is at most this many chips...
+  double tolerance;
+  // ... or if their difference is at least this many standard errors
+  double n_std_errors;
+  // Decisions that the hole class reaches with less than this share of its activity at the root - its
+  //   own reach probability times its counterfactual activity - don't need resolving
+  double min_activity_share;
+  // The most deals per round, as a multiple of the fixed deal count
+  int max_n_deals_factor;
+};
+
+struct ConvergeOneRoundConfig {
+  Dealer::DealerT& dealer;
+  int n_deals;
+  // The deal shards are shared out across this many worker threads
+  int n_threads;
+  bool do_dump;
+  StrategyAdjustPolicyT adjust_policy;
+  // Evaluate every hole class matchup against the exact showdown equity instead of dealing
+  bool exact_equity;
+  // Skip subtrees whose reach probabilities are at most this - see PlayerReach::prune_p
+  double prune_p;
+  FlatStorageT flat_storage;
+  AdaptiveDealConfigT adaptive_deals;
+  // Evaluate deals with external sampling Monte Carlo CFR instead of full traversal
+  bool external_sampling;
+};
+
+// Sanity-check counts of dealt hands
+struct DealCounts {
+  int n_p0_aa, n_p0_norm_aa;
+  int n_p0_kk, n_p0_norm_kk;
+  int n_hands;
+
+  void merge(const DealCounts& other) {
+    n_p0_aa += other.n_p0_aa; n_p0_norm_aa += other.n_p0_norm_aa;
+    n_p0_kk += other.n_p0_kk; n_p0_norm_kk += other.n_p0_norm_kk;
+    n_hands += other.n_hands;
+  }
+};
+
+// One worker's share of a round - its own deal stream and private evals.
+// The strategies are read-only for the duration of the round.
+struct EvalShard {
+  Dealer::DealerT* dealer;
+  // False if this shard uses the round's own dealer
+  bool owns_dealer;
+  int n_deals;
+  // Owned by the EvalShardArena
+  LimitRootTwoHandHoleHandEvals* p0_eval;
+  LimitRootTwoHandHoleHandEvals* p1_eval;
+  DealCounts counts;
+  // Timed on the thread that evaluates the shard
+  SolverPhaseTimesT times;
+};
+
+// Dealt rounds are always split into this many shards, whatever the number of threads, so that the
+//   deal streams and the shape of the reduction - and hence the evals, to the bit - don't depend on it.
+// Threads just share out the shards.
+static const int N_EVAL_SHARDS = 16;
+
+// The exact evaluation is a single cheap pass, so isn't worth splitting into shards.
+// Adaptive dealing decides after each batch where to deal next, so is sequential.
+static int get_n_eval_shards(bool exact_equity, bool adaptive_deals) {
+  return exact_equity || adaptive_deals ? 1 : N_EVAL_SHARDS;
+}
+
+// Eval containers of the shards, kept for the whole run so that the large eval trees are allocated
+//   and page-faulted once rather than every round.
+// The containers are not touched at allocation but are zeroed by the shard's own worker thread at the
+//   start of each round, so with first-touch NUMA placement each shard's pages are local to the
+//   thread that accumulates into them - shards are always given to the same thread, see evaluate_shards().
+struct EvalShardArena {
+  std::vector<LimitRootTwoHandHoleHandEvals*> p0_evals;
+  std::vector<LimitRootTwoHandHoleHandEvals*> p1_evals;
+
+  EvalShardArena(int n_shards) {
+    for(int i = 0; i < n_shards; i++) {
+      // Deliberately default- rather than value-initialised - see reset_shard_evals()
+      p0_evals.push_back(new LimitRootTwoHandHoleHandEvals);
+      p1_evals.push_back(new LimitRootTwoHandHoleHandEvals);
     }
   }
 
-  // Off-suit
-  for(RankT rank_hi = Ace; rank_hi > AceLow; rank_hi = (RankT)(rank_hi-1)) {
-    for(RankT rank_lo = (RankT)(rank_hi-1); rank_lo > AceLow; rank_lo = (RankT)(rank_lo-1)) {
-      adjust_strategies(player_strategies.get_suited_value(rank_hi, rank_lo), p0_eval.get_suited_value(rank_hi, rank_lo), p1_eval.get_suited_value(rank_hi, rank_lo), policy, stats);
+  ~EvalShardArena() {
+    for(std::size_t i = 0; i < p0_evals.size(); i++) {
+      delete p0_evals[i];
+      delete p1_evals[i];
     }
   }
+
+  EvalShardArena(const EvalShardArena&) = delete;
+  EvalShardArena& operator=(const EvalShardArena&) = delete;
+
+  inline int n_shards() const { return (int)p0_evals.size(); }
+};
+
+// Bulk reset of a shard's evals for a new round - on the thread that then evaluates the shard
+static void reset_shard_evals(EvalShard& shard) {
+  static_assert(std::is_trivially_copyable<LimitRootTwoHandHoleHandEvals>::value, "evals are reset by zeroing their memory");
+
+  memset((void*)shard.p0_eval, 0, sizeof(*shard.p0_eval));
+  memset((void*)shard.p1_eval, 0, sizeof(*shard.p1_eval));
 }
 
-struct ConvergeOneRoundConfig {
-  Dealer::DealerT& dealer;
+// Built once per storage policy - static local initialisation is thread-safe
+template <typename StorageT>
+static const FlatTree<LimitRootTwoHandStrategy, StorageT>& get_flat_tree() {
+  static const FlatTree<LimitRootTwoHandStrategy, StorageT> flat_tree;
+  return flat_tree;
+}
+
+template <typename StorageT>
+static void evaluate_matchups_flat(LimitRootTwoHandHoleHandStrategies& player_strategies, const HeadsUpClassMatchupsT& matchups, double prune_p, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval) {
+  typedef FlatTree<LimitRootTwoHandStrategy, StorageT> LimitRootTwoHandFlatTree;
+  const LimitRootTwoHandFlatTree& flat_tree = get_flat_tree<StorageT>();
+
+  // Allocate on the heap cos these are large-ish
+  std::vector<typename LimitRootTwoHandFlatTree::strategies_t> flat_strategies(1);
+  std::vector<typename LimitRootTwoHandFlatTree::evals_t> flat_evals(1);
+
+  flat_tree.flatten_strategies(player_strategies, flat_strategies[0]);
+  evaluate_heads_up_class_matchups_flat(flat_tree, flat_strategies[0], matchups, flat_evals[0], prune_p);
+  flat_tree.unflatten_evals(flat_evals[0], /*player_no*/0, p0_eval);
+  flat_tree.unflatten_evals(flat_evals[0], /*player_no*/1, p1_eval);
+}
+
+// Evaluate the weighted class matchups over the flattened tree layout, overwriting the evals
+static void evaluate_matchups_flat(LimitRootTwoHandHoleHandStrategies& player_strategies, const HeadsUpClassMatchupsT& matchups, double prune_p, FlatStorageT flat_storage, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval) {
+  switch(flat_storage) {
+  case FloatStorage:
+    evaluate_matchups_flat<FloatFlatStorage>(player_strategies, matchups, prune_p, p0_eval, p1_eval);
+    break;
+  case FixedStorage:
+    evaluate_matchups_flat<FixedFlatStorage>(player_strategies, matchups, prune_p, p0_eval, p1_eval);
+    break;
+  default:
+    evaluate_matchups_flat<DoubleFlatStorage>(player_strategies, matchups, prune_p, p0_eval, p1_eval);
+    break;
+  }
+}
+
+// Showdown outcomes of the deals of one hole class matchup
+struct DealtMatchupT {
   int n_deals;
-  bool do_dump;
-  StrategyAdjustPolicyT adjust_policy;
+  int n_p0_wins;
+  int n_ties;
 };
 
-static void converge_heads_up_preflop_strategies_one_round(LimitRootTwoHandHoleHandStrategies& player_strategies, const ConvergeOneRoundConfig& config, StrategyAdjustStatsT& stats) {
-  if(false && config.do_dump) {
-    printf("Evaluating preflop strategies\n\n");
-    dump_p0_strategy(player_strategies);
-    printf("\n\n");
-    dump_p1_strategy(player_strategies);
+// A dealt heads-up hand
+struct DealtHandT {
+  int hole_classes[2];
+  PlayerHandEvals<2> hand_evals;
+};
+
+// Deal one hand and evaluate both players' hands.
+// If is_wanted_class is non-null, deals where neither player's hole class is wanted are discarded
+//   before evaluating the hands.
+// @return false if the deal was discarded
+static bool deal_hand(Dealer::DealerT& dealer, const bool (*is_wanted_class)[Normal::N_HOLDEM_HOLE_CLASSES], bool do_dump, DealtHandT& hand, DealCounts& counts) {
+  auto cards = dealer.deal(2+2+3+1+1);
+
+  auto p0_hole = std::make_pair(CardT(cards[0+0]), CardT(cards[0+1]));
+  auto p1_hole = std::make_pair(CardT(cards[2+0]), CardT(cards[2+1]));
+
+  const int p0_hole_class = Normal::holdem_hole_class(cards[0+0], cards[0+1]);
+  const int p1_hole_class = Normal::holdem_hole_class(cards[2+0], cards[2+1]);
+
+  if(is_wanted_class != nullptr && !is_wanted_class[0][p0_hole_class] && !is_wanted_class[1][p1_hole_class]) {
+    return false;
   }
 
-  // Allocate on the heap cos these are large.
-  LimitRootTwoHandHoleHandEvals* ptr_p0_eval = new LimitRootTwoHandHoleHandEvals();
-  LimitRootTwoHandHoleHandEvals* ptr_p1_eval = new LimitRootTwoHandHoleHandEvals();
-  LimitRootTwoHandHoleHandEvals& p0_eval = *ptr_p0_eval;
-  LimitRootTwoHandHoleHandEvals& p1_eval = *ptr_p1_eval;
+  if((p0_hole.first.rank == Ace || p0_hole.first.rank == AceLow) && (p0_hole.second.rank == Ace || p0_hole.second.rank == AceLow)) {
+    counts.n_p0_aa++;
+  }
+  if(p0_hole_class == AceLow) {
+    counts.n_p0_norm_aa++;
+  }
+  if(p0_hole.first.rank == King && p0_hole.second.rank == King) {
+    counts.n_p0_kk++;
+  }
+  if(p0_hole_class == King) {
+    counts.n_p0_norm_kk++;
+  }
+  counts.n_hands++;
 
-  if(false && config.do_dump) {
-    // What is the initial state
-    printf("P0 SB - initial state - should be all 0.0\n\n");
-    dump_player_eval(true, p0_eval);
-    printf("\n\n");
-    printf("P1 BB - initial state - should be all 0.0\n\n");
-    dump_player_eval(false, p1_eval);
-    printf("\n\n");
+  if(false && do_dump) {
+    printf("Deal: p0 %c%c+%c%c class %d p1 %c%c+%c%c class %d\n",
+	   RANK_CHARS[p0_hole.first.rank], SUIT_CHARS[p0_hole.first.suit], RANK_CHARS[p0_hole.second.rank], SUIT_CHARS[p0_hole.second.suit], p0_hole_class,
+	   RANK_CHARS[p1_hole.first.rank], SUIT_CHARS[p1_hole.first.suit], RANK_CHARS[p1_hole.second.rank], SUIT_CHARS[p1_hole.second.suit], p1_hole_class);
   }
+  
+  hand.hole_classes[0] = p0_hole_class;
+  hand.hole_classes[1] = p1_hole_class;
+
+  const char* winner;
+  {
+    auto flop = std::make_tuple(CardT(cards[2*2]), CardT(cards[2*2 + 1]), CardT(cards[2*2 + 2]));
+    auto turn = CardT(cards[2*2 + 3]);
+    auto river = CardT(cards[2*2 + 4]);
+
+    auto p0_hand_eval = HandEval::eval_hand_holdem(p0_hole, flop, turn, river);
+    hand.hand_evals.evals[0] = p0_hand_eval;
+    auto p1_hand_eval = HandEval::eval_hand_holdem(p1_hole, flop, turn, river);
+    hand.hand_evals.evals[1] = p1_hand_eval;
+      
+    if(p0_hand_eval > p1_hand_eval) {
+      winner = "P0Wins";
+    } else if(p1_hand_eval > p0_hand_eval) {
+      winner = "P1Wins";
+    } else {
+      winner = "P0P1Push";
+    }
 
-  int n_p0_aa = 0, n_p0_norm_aa = 0;
-  int n_p0_kk = 0, n_p0_norm_kk = 0;
-  int n_hands = 0;
+    if(false && do_dump) {
+      printf("           flop %c%c+%c%c+%c%c turn %c%c river %c%c\n",
+	     RANK_CHARS[std::get<0>(flop).rank], SUIT_CHARS[std::get<0>(flop).suit], RANK_CHARS[std::get<1>(flop).rank], SUIT_CHARS[std::get<1>(flop).suit], RANK_CHARS[std::get<2>(flop).rank], SUIT_CHARS[std::get<2>(flop).suit],
+	     RANK_CHARS[turn.rank], SUIT_CHARS[turn.suit],
+	     RANK_CHARS[river.rank], SUIT_CHARS[river.suit]
+	     );
+      printf("                                                              p0 hand %s p1 hand %s winner %s\n", HAND_EVALS[p0_hand_eval.first], HAND_EVALS[p1_hand_eval.first], winner);
+    }
+  }
 
-  for(int deal_no = 0; deal_no < config.n_deals; deal_no++) {
-    auto cards = config.dealer.deal(2+2+3+1+1);
+  return true;
+}
+
+// Deal one hand and tally its showdown outcome into its hole class matchup - see deal_hand()
+// @return false if the deal was discarded
+static bool deal_matchup(Dealer::DealerT& dealer, const bool (*is_wanted_class)[Normal::N_HOLDEM_HOLE_CLASSES], bool do_dump, std::vector<DealtMatchupT>& dealt_matchups, DealCounts& counts) {
+  DealtHandT hand;
+  if(!deal_hand(dealer, is_wanted_class, do_dump, hand, counts)) {
+    return false;
+  }
 
-    auto p0_hole = std::make_pair(CardT(cards[0+0]), CardT(cards[0+1]));
-    auto p1_hole = std::make_pair(CardT(cards[2+0]), CardT(cards[2+1]));
+  DealtMatchupT& dealt_matchup = dealt_matchups[hand.hole_classes[0]*Normal::N_HOLDEM_HOLE_CLASSES + hand.hole_classes[1]];
+  dealt_matchup.n_deals++;
+  if(hand.hand_evals.evals[0] > hand.hand_evals.evals[1]) {
+    dealt_matchup.n_p0_wins++;
+  } else if(!(hand.hand_evals.evals[1] > hand.hand_evals.evals[0])) {
+    dealt_matchup.n_ties++;
+  }
 
-    auto p0_hole_norm = Normal::holdem_hole_normal(p0_hole.first, p0_hole.second);
-    auto p1_hole_norm = Normal::holdem_hole_normal(p1_hole.first, p1_hole.second);
+  return true;
+}
 
-    if((p0_hole.first.rank == Ace || p0_hole.first.rank == AceLow) && (p0_hole.second.rank == Ace || p0_hole.second.rank == AceLow)) {
-      n_p0_aa++;
+// All deals of a class matchup share the tree walk - the showdown profits are linear in the outcomes,
+//   so K deals are the same as one walk with chance probability K and the averaged outcome.
+// With exact_weights, matchups are instead weighted by their number of hole hand pairs and only the
+//   outcomes are sampled; matchups that were never dealt are then left out.
+static void make_dealt_matchups(const std::vector<DealtMatchupT>& dealt_matchups, bool exact_weights, HeadsUpClassMatchupsT& matchups) {
+  for(int p0_hole_class = 0; p0_hole_class < (int)Normal::N_HOLDEM_HOLE_CLASSES; p0_hole_class++) {
+    for(int p1_hole_class = 0; p1_hole_class < (int)Normal::N_HOLDEM_HOLE_CLASSES; p1_hole_class++) {
+      const DealtMatchupT& dealt_matchup = dealt_matchups[p0_hole_class*Normal::N_HOLDEM_HOLE_CLASSES + p1_hole_class];
+      HeadsUpShowdownEquity equity = {};
+      double weight = 0.0;
+      if(dealt_matchup.n_deals != 0) {
+	const double n_deals = (double)dealt_matchup.n_deals;
+	const int n_p1_wins = dealt_matchup.n_deals - dealt_matchup.n_p0_wins - dealt_matchup.n_ties;
+	equity = HeadsUpShowdownEquity{ dealt_matchup.n_p0_wins/n_deals, dealt_matchup.n_ties/n_deals, n_p1_wins/n_deals };
+	weight = exact_weights ? (double)Equity::holdem_preflop_equity(p0_hole_class, p1_hole_class).n_combo_pairs() : n_deals;
+      }
+      matchups.set_matchup(p0_hole_class, p1_hole_class, weight, equity, (double)dealt_matchup.n_deals);
     }
-    if((p0_hole_norm.first.rank == Ace || p0_hole_norm.first.rank == AceLow) && (p0_hole_norm.second.rank == Ace || p0_hole_norm.second.rank == AceLow)) {
-      n_p0_norm_aa++;
+  }
+}
+
+// Note that the strategies are only read, so can be shared between threads.
+static void evaluate_deals(LimitRootTwoHandHoleHandStrategies& player_strategies, Dealer::DealerT& dealer, int n_deals, bool do_dump, double prune_p, FlatStorageT flat_storage, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval, DealCounts& counts, SolverPhaseTimesT& times) {
+  SolverPhaseTimer timer;
+  std::vector<DealtMatchupT> dealt_matchups(Normal::N_HOLDEM_HOLE_CLASSES*Normal::N_HOLDEM_HOLE_CLASSES);
+
+  for(int deal_no = 0; deal_no < n_deals; deal_no++) {
+    deal_matchup(dealer, /*is_wanted_class*/nullptr, do_dump, dealt_matchups, counts);
+  }
+  timer.lap(times, DealPhase);
+
+  std::vector<HeadsUpClassMatchupsT> matchups(1);
+  make_dealt_matchups(dealt_matchups, /*exact_weights*/false, matchups[0]);
+
+  evaluate_matchups_flat(player_strategies, matchups[0], prune_p, flat_storage, p0_eval, p1_eval);
+  timer.lap(times, EvalPhase);
+}
+
+// External sampling Monte Carlo CFR - each deal is traversed once per player, with that player
+//   trying every action and the opponent playing a single action sampled from its strategy.
+// This accumulates into the per-hole-class evals directly, rather than through the flat layout, so
+//   it is the same code path as for larger trees where full traversal doesn't scale.
+// Note that the strategies are only read, so can be shared between threads.
+// Both players traverse one dealt hand - see LimitHandEvalSpecialised::sample_hand()
+static void traverse_external_sampling(LimitRootTwoHandHoleHandStrategies& player_strategies, const DealtHandT& hand, Dealer::DealerT& dealer, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval) {
+  PlayerStrategies<2, LimitRootTwoHandStrategy> player_hand_strategies = {};
+  PlayerEvals<2, LimitRootTwoHandEval> player_evals = {};
+
+  player_hand_strategies.strategies[0] = &player_strategies.get_class_value(hand.hole_classes[0]);
+  player_evals.evals[0] = &p0_eval.get_class_value(hand.hole_classes[0]);
+    
+  player_hand_strategies.strategies[1] = &player_strategies.get_class_value(hand.hole_classes[1]);
+  player_evals.evals[1] = &p1_eval.get_class_value(hand.hole_classes[1]);
+
+  for(int traverser_no = 0; traverser_no < 2; traverser_no++) {
+    LimitRootTwoHandEval::sample_hand(traverser_no, make_root_reach<2>(1.0), player_evals, player_hand_strategies, hand.hand_evals, dealer.rng);
+  }
+}
+
+// Hands are dealt in batches ahead of their traversals so that the two can be timed separately.
+static void evaluate_deals_external_sampling(LimitRootTwoHandHoleHandStrategies& player_strategies, Dealer::DealerT& dealer, int n_deals, bool do_dump, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval, DealCounts& counts, SolverPhaseTimesT& times) {
+  const int BATCH_N_DEALS = 1024;
+
+  SolverPhaseTimer timer;
+  std::vector<DealtHandT> hands(std::min(n_deals, BATCH_N_DEALS));
+
+  for(int batch_deal_no = 0; batch_deal_no < n_deals; batch_deal_no += BATCH_N_DEALS) {
+    const int batch_n_deals = std::min(BATCH_N_DEALS, n_deals - batch_deal_no);
+    for(int i = 0; i < batch_n_deals; i++) {
+      deal_hand(dealer, /*is_wanted_class*/nullptr, do_dump, hands[i], counts);
     }
-    if(p0_hole.first.rank == King && p0_hole.second.rank == King) {
-      n_p0_kk++;
+    timer.lap(times, DealPhase);
+
+    for(int i = 0; i < batch_n_deals; i++) {
+      traverse_external_sampling(player_strategies, hands[i], dealer, p0_eval, p1_eval);
     }
-    if(p0_hole_norm.first.rank == King && p0_hole_norm.second.rank == King) {
-      n_p0_norm_kk++;
+    timer.lap(times, TraversePhase);
+  }
+}
+
+typedef FlatTree<LimitRootTwoHandStrategy, DoubleFlatStorage> LimitRootTwoHandFlatTree;
+typedef HeadsUpFlatProfitVariancesT<LimitRootTwoHandFlatTree::n_nodes> LimitRootTwoHandFlatProfitVariances;
+
+// Find the hole classes with a strategy-relevant decision whose action values are not yet statistically
+//   resolved, from flat evals with sampling variances.
+// Each action's value is the acting player's counterfactual profit of the child per unit of counterfactual
+//   activity, as used for the strategy adjustment.
+// @return the number of unresolved (hole class, decision node)'s over both players
+static int find_unresolved_classes(const LimitRootTwoHandFlatTree& flat_tree, const LimitRootTwoHandFlatTree::strategies_t& flat_strategies, const LimitRootTwoHandFlatTree::evals_t& flat_evals, const LimitRootTwoHandFlatProfitVariances& variances, const AdaptiveDealConfigT& config, bool (*is_unresolved_class)[Normal::N_HOLDEM_HOLE_CLASSES]) {
+  const int N_NODES = LimitRootTwoHandFlatTree::n_nodes;
+  int n_unresolved = 0;
+
+  for(int n = 0; n < 2; n++) {
+    for(int c = 0; c < (int)Normal::N_HOLDEM_HOLE_CLASSES; c++) {
+      is_unresolved_class[n][c] = false;
+      const double root_activity = DoubleFlatStorage::from_accum(flat_evals.activity[n][0][c], flat_evals.scale);
+      if(root_activity <= 0.0) {
+	continue;
+      }
+
+      // The hole class's own reach probability, top-down
+      double own_reach[N_NODES];
+      own_reach[0] = 1.0;
+      for(int i = 1; i < N_NODES; i++) {
+	const FlatNodeT<2>& node = flat_tree.nodes[i];
+	const bool is_own_action = node.parent_action >= 0 && flat_tree.nodes[node.parent].player_no == n;
+	own_reach[i] = is_own_action ? own_reach[node.parent]*flat_strategies.action_p[node.parent_action][node.parent][c] : own_reach[node.parent];
+      }
+
+      for(int i = 0; i < N_NODES; i++) {
+	const FlatNodeT<2>& node = flat_tree.nodes[i];
+	if(node.player_no != n || (node.node_type != FoldCallRaiseNodeType && node.node_type != FoldCallNodeType)) {
+	  continue;
+	}
+	const double activity = DoubleFlatStorage::from_accum(flat_evals.activity[n][i][c], flat_evals.scale);
+	if(own_reach[i]*activity < config.min_activity_share*root_activity) {
+	  continue;
+	}
+
+	// Value and variance of the value of each action
+	double values[3], variances_of_values[3];
+	bool is_action[3];
+	for(int action = 0; action < 3; action++) {
+	  const int child = node.children[action];
+	  const double child_activity = child < 0 ? 0.0 : DoubleFlatStorage::from_accum(flat_evals.activity[n][child][c], flat_evals.scale);
+	  is_action[action] = child_activity > 0.0;
+	  if(is_action[action]) {
+	    values[action] = DoubleFlatStorage::from_accum(flat_evals.profits[n][n][child][c], flat_evals.scale) / child_activity;
+	    variances_of_values[action] = variances.variance[n][child][c] / (child_activity*child_activity);
+	  }
+	}
+
+	int best_action = -1;
+	for(int action = 0; action < 3; action++) {
+	  if(is_action[action] && (best_action < 0 || values[action] > values[best_action])) {
+	    best_action = action;
+	  }
+	}
+
+	bool is_resolved = true;
+	for(int action = 0; action < 3; action++) {
+	  if(!is_action[action] || action == best_action) {
+	    continue;
+	  }
+	  const double std_error = std::sqrt(variances_of_values[best_action] + variances_of_values[action]);
+	  is_resolved = is_resolved && (std_error <= config.tolerance || values[best_action] - values[action] >= config.n_std_errors*std_error);
+	}
+
+	if(!is_resolved) {
+	  is_unresolved_class[n][c] = true;
+	  n_unresolved++;
+	}
+      }
     }
-    n_hands++;
+  }
+
+  return n_unresolved;
+}
+
+// Deal in batches of config.batch_n_deals until every strategy-relevant action value is statistically
+//   resolved, or until max_n_deals hands have been evaluated. After the first batch, only deals where
+//   at least one player holds a hole class that is still unresolved are evaluated.
+// Since that skews the hole class matchups that are dealt, matchups are weighted by their exact number
+//   of hole hand pairs and only the showdown outcomes are sampled.
+// Note that the strategies are only read.
+// @return the number of deals evaluated
+static int evaluate_deals_adaptive(LimitRootTwoHandHoleHandStrategies& player_strategies, Dealer::DealerT& dealer, const AdaptiveDealConfigT& config, int max_n_deals, bool do_dump, double prune_p, FlatStorageT flat_storage, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval, DealCounts& counts, SolverPhaseTimesT& times) {
+  static_assert(std::is_trivially_copyable<LimitRootTwoHandFlatTree::evals_t>::value, "flat evals are reset by zeroing their memory");
+
+  SolverPhaseTimer timer;
 
-    if(false && config.do_dump) {
-      printf("Deal: p0 %c%c+%c%c p0-norm %c%c+%c%c p1 %c%c+%c%c p1-norm %c%c+%c%c\n",
-	     RANK_CHARS[p0_hole.first.rank], SUIT_CHARS[p0_hole.first.suit], RANK_CHARS[p0_hole.second.rank], SUIT_CHARS[p0_hole.second.suit], 
-	     RANK_CHARS[p0_hole_norm.first.rank], SUIT_CHARS[p0_hole_norm.first.suit], RANK_CHARS[p0_hole_norm.second.rank], SUIT_CHARS[p0_hole_norm.second.suit], 
-	     RANK_CHARS[p1_hole.first.rank], SUIT_CHARS[p1_hole.first.suit], RANK_CHARS[p1_hole.second.rank], SUIT_CHARS[p1_hole.second.suit], 
-	     RANK_CHARS[p1_hole_norm.first.rank], SUIT_CHARS[p1_hole_norm.first.suit], RANK_CHARS[p1_hole_norm.second.rank], SUIT_CHARS[p1_hole_norm.second.suit]);
+  // Give up on a batch after this many discarded deals per wanted deal - once very few hole classes are wanted
+  const int MAX_DISCARDS_PER_DEAL = 64;
+
+  const LimitRootTwoHandFlatTree& flat_tree = get_flat_tree<DoubleFlatStorage>();
+
+  // Allocate on the heap cos these are large-ish
+  std::vector<DealtMatchupT> dealt_matchups(Normal::N_HOLDEM_HOLE_CLASSES*Normal::N_HOLDEM_HOLE_CLASSES);
+  std::vector<HeadsUpClassMatchupsT> matchups(1);
+  std::vector<LimitRootTwoHandFlatTree::strategies_t> flat_strategies(1);
+  std::vector<LimitRootTwoHandFlatTree::evals_t> flat_evals(1);
+  std::vector<LimitRootTwoHandFlatProfitVariances> variances(1);
+
+  flat_tree.flatten_strategies(player_strategies, flat_strategies[0]);
+
+  bool is_wanted_class[2][Normal::N_HOLDEM_HOLE_CLASSES];
+  for(int n = 0; n < 2; n++) {
+    for(int c = 0; c < (int)Normal::N_HOLDEM_HOLE_CLASSES; c++) {
+      is_wanted_class[n][c] = true;
     }
-    
-    const char* winner;
-    PlayerHandEvals<2> player_hand_evals = {};
-    {
-      auto flop = std::make_tuple(CardT(cards[2*2]), CardT(cards[2*2 + 1]), CardT(cards[2*2 + 2]));
-      auto turn = CardT(cards[2*2 + 3]);
-      auto river = CardT(cards[2*2 + 4]);
-
-      auto p0_hand_eval = HandEval::eval_hand_holdem(p0_hole, flop, turn, river);
-      player_hand_evals.evals[0] = p0_hand_eval;
-      auto p1_hand_eval = HandEval::eval_hand_holdem(p1_hole, flop, turn, river);
-      player_hand_evals.evals[1] = p1_hand_eval;
-      
-      if(p0_hand_eval > p1_hand_eval) {
-	winner = "P0Wins";
-      } else if(p1_hand_eval > p0_hand_eval) {
-	winner = "P1Wins";
-      } else {
-	winner = "P0P1Push";
+  }
+
+  int n_deals = 0;
+  int n_batches = 0;
+  int n_unresolved = 0;
+  while(n_deals < max_n_deals) {
+    const int batch_n_deals = std::min(config.batch_n_deals, max_n_deals - n_deals);
+    int n_batch_deals = 0;
+    for(int n_attempts = 0; n_batch_deals < batch_n_deals && n_attempts < MAX_DISCARDS_PER_DEAL*batch_n_deals; n_attempts++) {
+      if(deal_matchup(dealer, is_wanted_class, do_dump, dealt_matchups, counts)) {
+	n_batch_deals++;
       }
+    }
+    n_deals += n_batch_deals;
+    n_batches++;
+    timer.lap(times, DealPhase);
+
+    make_dealt_matchups(dealt_matchups, /*exact_weights*/true, matchups[0]);
+    memset((void*)flat_evals.data(), 0, sizeof(flat_evals[0]));
+    memset((void*)variances.data(), 0, sizeof(variances[0]));
+    evaluate_heads_up_class_matchups_flat(flat_tree, flat_strategies[0], matchups[0], flat_evals[0], prune_p, variances.data());
+
+    n_unresolved = find_unresolved_classes(flat_tree, flat_strategies[0], flat_evals[0], variances[0], config, is_wanted_class);
+    timer.lap(times, EvalPhase);
+    if(n_unresolved == 0 || n_batch_deals < batch_n_deals) {
+      break;
+    }
+  }
+
+  printf("Adaptive deals: %d deals in %d batches of up to %d, capped at %d deals - %d unresolved decisions\n\n", n_deals, n_batches, config.batch_n_deals, max_n_deals, n_unresolved);
+
+  evaluate_matchups_flat(player_strategies, matchups[0], prune_p, flat_storage, p0_eval, p1_eval);
+  timer.lap(times, EvalPhase);
 
-      if(false && config.do_dump) {
-	printf("           flop %c%c+%c%c+%c%c turn %c%c river %c%c\n",
-	       RANK_CHARS[std::get<0>(flop).rank], SUIT_CHARS[std::get<0>(flop).suit], RANK_CHARS[std::get<1>(flop).rank], SUIT_CHARS[std::get<1>(flop).suit], RANK_CHARS[std::get<2>(flop).rank], SUIT_CHARS[std::get<2>(flop).suit],
-	       RANK_CHARS[turn.rank], SUIT_CHARS[turn.suit],
-	       RANK_CHARS[river.rank], SUIT_CHARS[river.suit]
-	       );
-	printf("                                                              p0 hand %s p1 hand %s winner %s\n", HAND_EVALS[p0_hand_eval.first], HAND_EVALS[p1_hand_eval.first], winner);
+  return n_deals;
+}
+
+// Evaluate every pair of hole classes once, weighted by the number of (disjoint) hole hand pairs,
+//   with the exact all-in equity of the matchup standing in for the board.
+// This replaces both the sampling noise and the hand evaluation of evaluate_deals().
+static void evaluate_class_matchups(LimitRootTwoHandHoleHandStrategies& player_strategies, double prune_p, FlatStorageT flat_storage, LimitRootTwoHandHoleHandEvals& p0_eval, LimitRootTwoHandHoleHandEvals& p1_eval, DealCounts& counts, SolverPhaseTimesT& times) {
+  SolverPhaseTimer timer;
+
+  static const std::vector<HeadsUpClassMatchupsT> exact_matchups = []() {
+    std::vector<HeadsUpClassMatchupsT> matchups(1);
+    make_exact_heads_up_class_matchups(matchups[0]);
+    return matchups;
+  }();
+
+  evaluate_matchups_flat(player_strategies, exact_matchups[0], prune_p, flat_storage, p0_eval, p1_eval);
+  timer.lap(times, EvalPhase);
+
+  for(int p0_hole_class = 0; p0_hole_class < (int)Normal::N_HOLDEM_HOLE_CLASSES; p0_hole_class++) {
+    for(int p1_hole_class = 0; p1_hole_class < (int)Normal::N_HOLDEM_HOLE_CLASSES; p1_hole_class++) {
+      const int n_combo_pairs = (int)Equity::holdem_preflop_equity(p0_hole_class, p1_hole_class).n_combo_pairs();
+
+      if(p0_hole_class == AceLow) {
+	counts.n_p0_aa += n_combo_pairs;
+	counts.n_p0_norm_aa += n_combo_pairs;
       }
+      if(p0_hole_class == King) {
+	counts.n_p0_kk += n_combo_pairs;
+	counts.n_p0_norm_kk += n_combo_pairs;
+      }
+      counts.n_hands += n_combo_pairs;
     }
+  }
+}
 
-    PlayerStrategies<2, LimitRootTwoHandStrategy> player_hand_strategies = {};
-    PlayerEvals<2, LimitRootTwoHandEval> player_evals = {};
+static void evaluate_shard(LimitRootTwoHandHoleHandStrategies& player_strategies, EvalShard& shard, bool do_dump, double prune_p, FlatStorageT flat_storage, bool external_sampling) {
+  reset_shard_evals(shard);
+  if(external_sampling) {
+    evaluate_deals_external_sampling(player_strategies, *shard.dealer, shard.n_deals, do_dump, *shard.p0_eval, *shard.p1_eval, shard.counts, shard.times);
+  } else {
+    evaluate_deals(player_strategies, *shard.dealer, shard.n_deals, do_dump, prune_p, flat_storage, *shard.p0_eval, *shard.p1_eval, shard.counts, shard.times);
+  }
+}
 
-    player_hand_strategies.strategies[0] = &player_strategies.get_value(p0_hole_norm.first, p0_hole_norm.second);
-    player_evals.evals[0] = &p0_eval.get_value(p0_hole_norm.first, p0_hole_norm.second);
-    
-    player_hand_strategies.strategies[1] = &player_strategies.get_value(p1_hole_norm.first, p1_hole_norm.second);
-    player_evals.evals[1] = &p1_eval.get_value(p1_hole_norm.first, p1_hole_norm.second);
+// Worker thread_no of n_threads evaluates every n_threads'th shard
+static void evaluate_shards(LimitRootTwoHandHoleHandStrategies& player_strategies, std::vector<EvalShard>& shards, int thread_no, int n_threads, bool do_dump, double prune_p, FlatStorageT flat_storage, bool external_sampling) {
+  for(std::size_t i = thread_no; i < shards.size(); i += n_threads) {
+    evaluate_shard(player_strategies, shards[i], do_dump, prune_p, flat_storage, external_sampling);
+  }
+}
 
-    LimitRootTwoHandEval::evaluate_hand(1.0, player_evals, player_hand_strategies, player_hand_evals);
+// Merge shards[i + stride] into shards[i] for every pair of this level of the reduction tree
+static void merge_shard_pairs(std::vector<EvalShard>& shards, int stride, int thread_no, int n_threads) {
+  const int n_shards = (int)shards.size();
+  for(int i = 2*stride*thread_no; i + stride < n_shards; i += 2*stride*n_threads) {
+    shards[i].p0_eval->merge(*shards[i + stride].p0_eval);
+    shards[i].p1_eval->merge(*shards[i + stride].p1_eval);
+    shards[i].counts.merge(shards[i + stride].counts);
+    shards[i].times.merge(shards[i + stride].times);
   }
+}
+
+// Fixed-shape pairwise tree reduction into shard 0.
+// Floating point addition isn't associative, so the evals only come out the same to the bit because the
+//   tree depends on nothing but the number of shards. Threads only share out the (independent) merges of
+//   each level, which are streaming adds so bandwidth-bound.
+static void reduce_shards(std::vector<EvalShard>& shards, int n_threads) {
+  const int n_shards = (int)shards.size();
+  for(int stride = 1; stride < n_shards; stride *= 2) {
+    const int n_merges = (n_shards - stride + 2*stride - 1)/(2*stride);
+    const int n_merge_threads = std::min(n_threads, n_merges);
+    if(n_merge_threads <= 1) {
+      merge_shard_pairs(shards, stride, /*thread_no*/0, /*n_threads*/1);
+      continue;
+    }
+    std::vector<std::thread> threads;
+    for(int t = 0; t < n_merge_threads; t++) {
+      threads.push_back(std::thread(merge_shard_pairs, std::ref(shards), stride, t, n_merge_threads));
+    }
+    for(int t = 0; t < n_merge_threads; t++) {
+      threads[t].join();
+    }
+  }
+}
+
+// Number of (decision node, hole class)'s whose acting player had no counterfactual activity at all
+static int count_zero_activity_decisions(const LimitRootTwoHandHoleHandEvals& p0_eval, const LimitRootTwoHandHoleHandEvals& p1_eval, int& n_decisions) {
+  const LimitRootTwoHandFlatTree& flat_tree = get_flat_tree<DoubleFlatStorage>();
+
+  // Allocate on the heap cos these are large-ish
+  std::vector<LimitRootTwoHandFlatTree::evals_t> flat_evals(1);
+  flat_tree.flatten_evals(p0_eval, /*player_no*/0, flat_evals[0]);
+  flat_tree.flatten_evals(p1_eval, /*player_no*/1, flat_evals[0]);
+
+  int n_zero_activity = 0;
+  n_decisions = 0;
+  for(int i = 0; i < LimitRootTwoHandFlatTree::n_nodes; i++) {
+    const FlatNodeT<2>& node = flat_tree.nodes[i];
+    if(node.node_type != FoldCallRaiseNodeType && node.node_type != FoldCallNodeType) {
+      continue;
+    }
+    for(int c = 0; c < (int)Normal::N_HOLDEM_HOLE_CLASSES; c++) {
+      n_decisions++;
+      if(flat_evals[0].activity[node.player_no][i][c] == 0.0) {
+	n_zero_activity++;
+      }
+    }
+  }
+
+  return n_zero_activity;
+}
+
+// Max and mean L1 distance of the strategy of each (decision node, hole class) between two flat strategies
+static void get_strategy_l1_deltas(const LimitRootTwoHandFlatTree::strategies_t& before, const LimitRootTwoHandFlatTree::strategies_t& after, double& max_delta, double& mean_delta) {
+  const LimitRootTwoHandFlatTree& flat_tree = get_flat_tree<DoubleFlatStorage>();
+
+  max_delta = 0.0;
+  double total_delta = 0.0;
+  int n_decisions = 0;
+  for(int i = 0; i < LimitRootTwoHandFlatTree::n_nodes; i++) {
+    const FlatNodeT<2>& node = flat_tree.nodes[i];
+    if(node.node_type != FoldCallRaiseNodeType && node.node_type != FoldCallNodeType) {
+      continue;
+    }
+    for(int c = 0; c < (int)Normal::N_HOLDEM_HOLE_CLASSES; c++) {
+      double delta = 0.0;
+      for(int action = 0; action < 3; action++) {
+	delta += std::abs(after.action_p[action][i][c] - before.action_p[action][i][c]);
+      }
+      max_delta = std::max(max_delta, delta);
+      total_delta += delta;
+      n_decisions++;
+    }
+  }
+
+  mean_delta = total_delta/n_decisions;
+}
+
+// @param metrics gets the phase times, node coverage and strategy deltas of the round if non-null
+static void converge_heads_up_preflop_strategies_one_round(LimitRootTwoHandHoleHandStrategies& player_strategies, const ConvergeOneRoundConfig& config, EvalShardArena& arena, StrategyAdjustStatsT& stats, SolverRoundMetricsT* metrics) {
+  if(false && config.do_dump) {
+    printf("Evaluating preflop strategies\n\n");
+    dump_p0_strategy(player_strategies);
+    printf("\n\n");
+    dump_p1_strategy(player_strategies);
+  }
+
+  const int n_shards = arena.n_shards();
+  const int n_threads = std::max(1, std::min(config.n_threads, n_shards));
+
+  // Each shard gets its own dealer seeded from the master dealer.
+  // A single shard just uses the master dealer.
+  std::vector<EvalShard> shards(n_shards);
+  for(int i = 0; i < n_shards; i++) {
+    EvalShard& shard = shards[i];
+    shard.owns_dealer = n_shards != 1;
+    if(shard.owns_dealer) {
+      std::seed_seq shard_seed{ (u32)config.dealer.rng(), (u32)config.dealer.rng(), (u32)i };
+      shard.dealer = new Dealer::DealerT(shard_seed);
+    } else {
+      shard.dealer = &config.dealer;
+    }
+    shard.n_deals = config.n_deals/n_shards + (i < config.n_deals % n_shards ? 1 : 0);
+    shard.p0_eval = arena.p0_evals[i];
+    shard.p1_eval = arena.p1_evals[i];
+    shard.counts = {};
+    shard.times = {};
+  }
+
+  int n_deals = config.n_deals;
+  if(config.exact_equity) {
+    reset_shard_evals(shards[0]);
+    evaluate_class_matchups(player_strategies, config.prune_p, config.flat_storage, *shards[0].p0_eval, *shards[0].p1_eval, shards[0].counts, shards[0].times);
+  } else if(config.adaptive_deals.is_adaptive) {
+    reset_shard_evals(shards[0]);
+    n_deals = evaluate_deals_adaptive(player_strategies, config.dealer, config.adaptive_deals, config.adaptive_deals.max_n_deals_factor*config.n_deals, config.do_dump, config.prune_p, config.flat_storage, *shards[0].p0_eval, *shards[0].p1_eval, shards[0].counts, shards[0].times);
+  } else if(n_threads == 1) {
+    evaluate_shards(player_strategies, shards, /*thread_no*/0, /*n_threads*/1, config.do_dump, config.prune_p, config.flat_storage, config.external_sampling);
+  } else {
+    std::vector<std::thread> threads;
+    for(int t = 0; t < n_threads; t++) {
+      threads.push_back(std::thread(evaluate_shards, std::ref(player_strategies), std::ref(shards), t, n_threads, config.do_dump, config.prune_p, config.flat_storage, config.external_sampling));
+    }
+    for(int t = 0; t < n_threads; t++) {
+      threads[t].join();
+    }
+  }
+
+  SolverPhaseTimer reduce_timer(CLOCK_PROCESS_CPUTIME_ID);
+  reduce_shards(shards, n_threads);
+  SolverPhaseTimesT& times = shards[0].times;
+  reduce_timer.lap(times, ReducePhase);
+
+  LimitRootTwoHandHoleHandEvals& p0_eval = *shards[0].p0_eval;
+  LimitRootTwoHandHoleHandEvals& p1_eval = *shards[0].p1_eval;
+  const DealCounts& counts = shards[0].counts;
 
   if(true && config.do_dump) {
-    printf("P0 AA %d norm AA %d\n\n", n_p0_aa, n_p0_norm_aa);
-    printf("P0 KK %d norm KK %d\n\n", n_p0_kk, n_p0_norm_kk);
-    printf("   n_hands %d expecting %d - AA is %.4lf%% KK is %.4lf%%\n", n_hands, config.n_deals, (double)n_p0_aa/(double)n_hands * 100.0, (double)n_p0_kk/(double)n_hands * 100.0);
+    printf("P0 AA %d norm AA %d\n\n", counts.n_p0_aa, counts.n_p0_norm_aa);
+    printf("P0 KK %d norm KK %d\n\n", counts.n_p0_kk, counts.n_p0_norm_kk);
+    printf("   n_hands %d expecting %d - AA is %.4lf%% KK is %.4lf%%\n", counts.n_hands, config.exact_equity ? counts.n_hands : n_deals, (double)counts.n_p0_aa/(double)counts.n_hands * 100.0, (double)counts.n_p0_kk/(double)counts.n_hands * 100.0);
     // What is the outcome
     printf("P0 SB - outcomes\n\n");
     dump_player_eval(true, p0_eval);
@@ -353,13 +941,47 @@ static void converge_heads_up_preflop_strategies_one_round(LimitRootTwoHandHoleH
     printf("\n\n");
   }
 
+  // Allocate on the heap cos these are large-ish
+  std::vector<LimitRootTwoHandFlatTree::strategies_t> flat_strategies(metrics != nullptr ? 2 : 0);
+  if(metrics != nullptr) {
+    metrics->n_deals = config.exact_equity ? 0 : n_deals;
+    metrics->n_zero_activity_decisions = count_zero_activity_decisions(p0_eval, p1_eval, metrics->n_decisions);
+    get_flat_tree<DoubleFlatStorage>().flatten_strategies(player_strategies, flat_strategies[0]);
+  }
+
   printf("Adjusting strategies...\n\n");
+  SolverPhaseTimer adjust_timer(CLOCK_PROCESS_CPUTIME_ID);
   adjust_strategies(player_strategies, p0_eval, p1_eval, config.adjust_policy, stats);
+  adjust_timer.lap(times, AdjustPhase);
+
+  if(metrics != nullptr) {
+    get_flat_tree<DoubleFlatStorage>().flatten_strategies(player_strategies, flat_strategies[1]);
+    get_strategy_l1_deltas(flat_strategies[0], flat_strategies[1], metrics->max_strategy_l1_delta, metrics->mean_strategy_l1_delta);
+    metrics->phase_times = times;
+  }
+
+  for(int i = 0; i < n_shards; i++) {
+    if(shards[i].owns_dealer) {
+      delete shards[i].dealer;
+    }
+  }
+}
+
+// Replace the strategies with the CFR average strategies
+static void use_average_strategies(LimitRootTwoHandHoleHandStrategies& player_strategies) {
+  // Evals are unused for AdjustToAverage - allocate on the heap cos these are large.
+  LimitRootTwoHandHoleHandEvals* p0_eval = new LimitRootTwoHandHoleHandEvals();
+  LimitRootTwoHandHoleHandEvals* p1_eval = new LimitRootTwoHandHoleHandEvals();
+  const StrategyAdjustPolicyT policy = { AdjustToAverage, /*leeway*/0.0, /*min_strategy*/0.0, NoClamp, /*cfr_iteration*/0 };
+  StrategyAdjustStatsT stats = {};
 
-  delete ptr_p0_eval;
-  delete ptr_p1_eval;
+  adjust_strategies(player_strategies, *p0_eval, *p1_eval, policy, stats);
+
+  delete p0_eval;
+  delete p1_eval;
 }
 
+// Initialise with designated initializers - fields that are left out are zero
 struct ConvergeConfig {
   Dealer::DealerT& dealer;
   int n_rounds;
@@ -371,22 +993,59 @@ struct ConvergeConfig {
   StrategyClampT clamp_policy;
   int clamp_to_min_n_rounds; // Only if clamp_policy is ClampToZero
   int dump_n_rounds; // Dump output only every dump_n_rounds rounds; 0 for never dump
+  int n_threads; // Evaluation worker threads per round
+  bool exact_equity; // Evaluate hole class matchups against exact showdown equity rather than dealing n_deals
+  double target_exploitability; // Stop once exploitability is at most this many chips per hand; 0.0 to run all rounds
+  double prune_p; // Prune subtrees with reach probabilities at most this; 0.0 for no pruning
+  int prune_revisit_n_rounds; // Evaluate without pruning every prune_revisit_n_rounds rounds so that pruned subtrees stay correct
+  FlatStorageT flat_storage; // Storage of the flat evaluation arrays
+  int start_round; // Non-zero when resuming from a checkpoint
+  int checkpoint_n_rounds; // Checkpoint every checkpoint_n_rounds rounds; 0 for never
+  std::string checkpoint_path;
+  AdaptiveDealConfigT adaptive_deals; // If adaptive, n_deals scales the most deals per round
+  bool external_sampling; // Evaluate n_deals with external sampling Monte Carlo CFR
+  FILE* metrics_file; // Write a JSON line of SolverRoundMetricsT per round; nullptr for none
 };
 
+// Exploitability of the strategies that the solver would return now - for CFR that's the average strategy
+static HeadsUpExploitabilityT get_exploitability(const LimitRootTwoHandHoleHandStrategies& hole_hand_strategies, StrategyAdjustT adjust) {
+  if(adjust == AdjustCfrPlus || adjust == AdjustDcfr) {
+    LimitRootTwoHandHoleHandStrategies* average_strategies = new LimitRootTwoHandHoleHandStrategies(hole_hand_strategies);
+    use_average_strategies(*average_strategies);
+    HeadsUpExploitabilityT exploitability = heads_up_exploitability(*average_strategies);
+    delete average_strategies;
+    return exploitability;
+  }
+
+  return heads_up_exploitability(hole_hand_strategies);
+}
+
 //template <int N_PLAYERS, typename HandStrategyT>
 static void converge_heads_up_preflop_strategies(LimitRootTwoHandHoleHandStrategies& hole_hand_strategies, const ConvergeConfig& config, StrategyAdjustT adjust) {
 
-  int n_deals = config.n_deals;
-  double leeway = config.leeway;
+  // Resumed solves pick up the schedule where they left off
+  int n_deals = config.n_deals + config.start_round*config.n_deals_inc;
+  double leeway = config.leeway + config.start_round*config.leeway_inc;
+
+  EvalShardArena arena(get_n_eval_shards(config.exact_equity, config.adaptive_deals.is_adaptive));
   
-  for(int round = 0; round < config.n_rounds; round++) {
+  for(int round = config.start_round; round < config.n_rounds; round++) {
+    const double round_wall_secs = get_wall_secs();
+    const double round_cpu_secs = get_cpu_secs(CLOCK_PROCESS_CPUTIME_ID);
+
     printf("\n\n");
     printf("==========================================================================================\n");
     printf("==============                                                             ===============\n");
     printf("==============                     Round %3d                               ===============\n", round);
     printf("==============                                                             ===============\n");
     printf("==========================================================================================\n\n");
-    printf("deals %d - leeway %.2lf\n\n", n_deals, leeway);
+    if(config.exact_equity) {
+      printf("exact equity - leeway %.2lf\n\n", leeway);
+    } else if(config.adaptive_deals.is_adaptive) {
+      printf("adaptive deals up to %d - leeway %.2lf\n\n", config.adaptive_deals.max_n_deals_factor*n_deals, leeway);
+    } else {
+      printf("deals %d - leeway %.2lf\n\n", n_deals, leeway);
+    }
 
     bool do_dump = config.dump_n_rounds != 0 && round % config.dump_n_rounds == 0;
     
@@ -402,13 +1061,50 @@ static void converge_heads_up_preflop_strategies(LimitRootTwoHandHoleHandStrateg
     if(clamp_policy == ClampToZero && config.clamp_to_min_n_rounds != 0 && round % config.clamp_to_min_n_rounds == 0) {
       clamp_policy = ClampToMin;
     }
-    const ConvergeOneRoundConfig one_round_config = { config.dealer, n_deals, do_dump, { adjust, leeway, config.min_strategy, clamp_policy } };
+    const bool do_prune = config.prune_p > 0.0 && !(config.prune_revisit_n_rounds != 0 && round % config.prune_revisit_n_rounds == 0);
+    const double prune_p = do_prune ? config.prune_p : 0.0;
+
+    const ConvergeOneRoundConfig one_round_config = { config.dealer, n_deals, config.n_threads, do_dump, { adjust, leeway, config.min_strategy, clamp_policy, /*cfr_iteration*/round+1 }, config.exact_equity, prune_p, config.flat_storage, config.adaptive_deals, config.external_sampling };
     StrategyAdjustStatsT stats = {};
+    SolverRoundMetricsT metrics = {};
 
-    converge_heads_up_preflop_strategies_one_round(hole_hand_strategies, one_round_config, stats);
+    converge_heads_up_preflop_strategies_one_round(hole_hand_strategies, one_round_config, arena, stats, config.metrics_file != nullptr ? &metrics : nullptr);
     
     printf("\n\n... finished evaluation and adjustment - %d max(p) changes\n\n", stats.n_max_p_action_changes);
 
+    SolverPhaseTimer exploitability_timer(CLOCK_PROCESS_CPUTIME_ID);
+    const HeadsUpExploitabilityT exploitability = get_exploitability(hole_hand_strategies, adjust);
+    exploitability_timer.lap(metrics.phase_times, ExploitabilityPhase);
+    printf("Exploitability: %.6lf chips/hand - P0 value %.6lf, P0 exploitable by %.6lf, P1 exploitable by %.6lf\n\n", exploitability.exploitability(), exploitability.p0_value, exploitability.p0_exploitability(), exploitability.p1_exploitability());
+
+    if(config.metrics_file != nullptr) {
+      metrics.round = round;
+      metrics.wall_secs = get_wall_secs() - round_wall_secs;
+      metrics.cpu_secs = get_cpu_secs(CLOCK_PROCESS_CPUTIME_ID) - round_cpu_secs;
+      metrics.exploitability = exploitability.exploitability();
+      metrics.rss_mb = get_rss_mb();
+      metrics.max_rss_mb = get_max_rss_mb();
+      write_solver_round_metrics_json(config.metrics_file, metrics);
+    }
+
+    const bool is_target_reached = config.target_exploitability > 0.0 && exploitability.exploitability() <= config.target_exploitability;
+
+    // Always checkpoint the final strategies, so that they can warm start a solve of another tree
+    const bool is_last_round = is_target_reached || round+1 == config.n_rounds;
+    if(config.checkpoint_n_rounds != 0 && ((round+1) % config.checkpoint_n_rounds == 0 || is_last_round)) {
+      if(write_limit_strategy_checkpoint(config.checkpoint_path, hole_hand_strategies, round+1, adjust)) {
+	printf("Checkpointed %d rounds to %s\n\n", round+1, config.checkpoint_path.c_str());
+      } else {
+	fprintf(stderr, "Failed to write checkpoint %s\n", config.checkpoint_path.c_str());
+      }
+    }
+
+    if(is_target_reached) {
+      printf("===================================== Reached target exploitability %.6lf after %d rounds ========================================\n\n", config.target_exploitability, round+1);
+
+      break;
+    }
+
     if(stats.n_max_p_action_changes == 0 && adjust == AdjustToMax) {
       printf("===================================== No More AdjustToMax ========================================\n\n");
 
@@ -418,9 +1114,42 @@ static void converge_heads_up_preflop_strategies(LimitRootTwoHandHoleHandStrateg
     n_deals += config.n_deals_inc;
     leeway += config.leeway_inc;
   }
+
+  // CFR converges in the average strategy, not in the strategy of the last iteration
+  if(adjust == AdjustCfrPlus || adjust == AdjustDcfr) {
+    use_average_strategies(hole_hand_strategies);
+  }
 }
 
-int main() {
+// Warm start from the checkpoint of a different tree - see warm_start_limit_strategies().
+// The CFR iterations restart from the first - only the checkpoint's average strategy carries over.
+// @return true if there was a usable checkpoint
+template <typename SrcRootStrategyT>
+static bool warm_start_from_checkpoint(LimitRootTwoHandHoleHandStrategies& hole_hand_strategies, StrategyAdjustT adjust) {
+  const std::string path = limit_strategy_checkpoint_path<SrcRootStrategyT>();
+  const LimitStrategyCheckpointT<SrcRootStrategyT>* checkpoint = map_limit_strategy_checkpoint<SrcRootStrategyT>(path);
+  if(checkpoint == nullptr) {
+    return false;
+  }
+  if(checkpoint->adjust != (u32)adjust) {
+    printf("Checkpoint %s is from a different adjust mode - not warm starting from it\n", path.c_str());
+    unmap_limit_strategy_checkpoint(checkpoint);
+    return false;
+  }
+
+  const LimitWarmStartStatsT stats = warm_start_limit_strategies(checkpoint->strategies, hole_hand_strategies);
+  printf("Warm started from checkpoint %s after %d rounds - %d decision nodes, %d exact, %d by prefix, %d unmatched\n", path.c_str(), (int)checkpoint->n_rounds_done, stats.n_decisions, stats.n_exact, stats.n_prefix, stats.n_unmatched);
+  unmap_limit_strategy_checkpoint(checkpoint);
+  return true;
+}
+
+static bool is_number(const std::string& arg) {
+  return !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c) { return '0' <= c && c <= '9'; });
+}
+
+static const char* USAGE = "Usage: preflop-gto [<n-threads>] [sampled|adaptive|mccfr] [converge|cfr+|dcfr] [prune] [float|fixed] [checkpoint] [resume] [warm] [metrics]\n";
+
+int main(int argc, char* argv[]) {
   int N_FAST_ROUNDS = 16;
   int N_ROUNDS = 128 + 1;
   //int N_ROUNDS = 1000;
@@ -441,17 +1170,123 @@ int main() {
   int dump_n_rounds = 16;
   StrategyClampT clamp_policy = ClampToMin;
   int clamp_to_min_n_rounds = 4; // only useful if clamp_policy is ClampToZero
+  int n_threads = std::max(1, (int)std::thread::hardware_concurrency());
+  bool exact_equity = true;
+  StrategyAdjustT adjust = AdjustDcfr;
+  double target_exploitability = 0.0001;
+  double prune_p = 0.0;
+  int prune_revisit_n_rounds = 8;
+  FlatStorageT flat_storage = DoubleStorage;
+  int checkpoint_n_rounds = 0;
+  bool resume = false;
+  bool warm = false;
+  bool write_metrics = false;
+  bool external_sampling = false;
+  // Resolve action values to within 0.05 chips, or two standard errors, dealing batches of 1/16 of the fixed deal count
+  AdaptiveDealConfigT adaptive_deals = { /*is_adaptive*/false, /*batch_n_deals*/N_DEALS/16, /*tolerance*/0.05, /*n_std_errors*/2.0, /*min_activity_share*/0.02, /*max_n_deals_factor*/2 };
+  const std::string checkpoint_path = limit_strategy_checkpoint_path<LimitRootTwoHandStrategy>();
+  const std::string metrics_path = TableFile::table_dir() + "/preflop-gto-metrics.jsonl";
+
+  for(int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "sampled") {
+      exact_equity = false;
+    } else if(arg == "mccfr") {
+      exact_equity = false;
+      external_sampling = true;
+    } else if(arg == "adaptive") {
+      exact_equity = false;
+      adaptive_deals.is_adaptive = true;
+    } else if(arg == "converge") {
+      adjust = AdjustConverge;
+    } else if(arg == "cfr+") {
+      adjust = AdjustCfrPlus;
+    } else if(arg == "dcfr") {
+      adjust = AdjustDcfr;
+    } else if(arg == "prune") {
+      prune_p = 0.000001;
+    } else if(arg == "float") {
+      flat_storage = FloatStorage;
+    } else if(arg == "fixed") {
+      flat_storage = FixedStorage;
+    } else if(arg == "checkpoint") {
+      checkpoint_n_rounds = 16;
+    } else if(arg == "resume") {
+      resume = true;
+    } else if(arg == "warm") {
+      warm = true;
+    } else if(arg == "metrics") {
+      write_metrics = true;
+    } else if(is_number(arg)) {
+      n_threads = std::atoi(argv[i]);
+    } else {
+      fprintf(stderr, "preflop-gto: unknown argument '%s'\n%s", argv[i], USAGE);
+      return 1;
+    }
+  }
+
+  if(exact_equity) {
+    printf("Evaluating with exact preflop equity\n");
+  } else if(adaptive_deals.is_adaptive) {
+    printf("Evaluating with adaptive deals\n");
+  } else if(external_sampling) {
+    printf("Evaluating with external sampling MCCFR with %d threads\n", n_threads);
+  } else {
+    printf("Evaluating with %d threads\n", n_threads);
+  }
+  // Used for exploitability even when dealing - generating the table takes a while the first time
+  Equity::load_holdem_preflop_equity_matrix();
   
   std::seed_seq seed{1, 2, 3, 4, 6};
   Dealer::DealerT dealer(seed);
 
+  // One JSON object per line per round - see SolverRoundMetricsT
+  FILE* metrics_file = nullptr;
+  if(write_metrics) {
+    metrics_file = fopen(metrics_path.c_str(), "w");
+    if(metrics_file == nullptr) {
+      fprintf(stderr, "Failed to open metrics file %s\n", metrics_path.c_str());
+    }
+  }
+
   // Allocate on heap, not stack cos this is a fairly large structure
   LimitRootTwoHandHoleHandStrategies* hole_hand_strategies = new LimitRootTwoHandHoleHandStrategies();
 
+  int start_round = 0;
+  if(resume) {
+    const LimitStrategyCheckpointT<LimitRootTwoHandStrategy>* checkpoint = map_limit_strategy_checkpoint<LimitRootTwoHandStrategy>(checkpoint_path);
+    if(checkpoint == nullptr) {
+      printf("No usable checkpoint %s - starting from scratch\n", checkpoint_path.c_str());
+    } else if(checkpoint->adjust != (u32)adjust) {
+      printf("Checkpoint %s is from a different adjust mode - starting from scratch\n", checkpoint_path.c_str());
+      unmap_limit_strategy_checkpoint(checkpoint);
+    } else {
+      *hole_hand_strategies = checkpoint->strategies;
+      start_round = (int)checkpoint->n_rounds_done;
+      printf("Resuming from checkpoint %s after %d rounds\n", checkpoint_path.c_str(), start_round);
+      unmap_limit_strategy_checkpoint(checkpoint);
+    }
+  }
+
+  // Otherwise from the tree with one raise fewer, else one more, if it has a checkpoint - e.g. from preflop-gto-r2
+  if(warm && start_round == 0) {
+    typedef typename LimitRootHandStrategy<2, PREFLOP_GTO_N_RAISES-1, PREFLOP_GTO_SMALL_BLIND, PREFLOP_GTO_BIG_BLIND>::type_t FewerRaisesRootStrategy;
+    typedef typename LimitRootHandStrategy<2, PREFLOP_GTO_N_RAISES+1, PREFLOP_GTO_SMALL_BLIND, PREFLOP_GTO_BIG_BLIND>::type_t MoreRaisesRootStrategy;
+    if(!warm_start_from_checkpoint<FewerRaisesRootStrategy>(*hole_hand_strategies, adjust)
+       && !warm_start_from_checkpoint<MoreRaisesRootStrategy>(*hole_hand_strategies, adjust)) {
+      printf("No checkpoint to warm start from - starting from scratch\n");
+    }
+  }
+
   if(false) {
     printf("\n\n========================================== AdjustToMax ==============================================\n\n");
 
-    const ConvergeConfig fast_config = { dealer, N_FAST_ROUNDS, N_DEALS, N_DEALS_INC, leeway, leeway_inc, min_strategy, clamp_policy, clamp_to_min_n_rounds, dump_n_rounds };
+    const ConvergeConfig fast_config = {
+      .dealer = dealer, .n_rounds = N_FAST_ROUNDS, .n_deals = N_DEALS, .n_deals_inc = N_DEALS_INC, .leeway = leeway, .leeway_inc = leeway_inc,
+      .min_strategy = min_strategy, .clamp_policy = clamp_policy, .clamp_to_min_n_rounds = clamp_to_min_n_rounds, .dump_n_rounds = dump_n_rounds,
+      .n_threads = n_threads, .exact_equity = exact_equity, .target_exploitability = target_exploitability,
+      .prune_p = prune_p, .prune_revisit_n_rounds = prune_revisit_n_rounds, .flat_storage = flat_storage,
+      .adaptive_deals = adaptive_deals, .external_sampling = external_sampling };
   
     converge_heads_up_preflop_strategies(*hole_hand_strategies, fast_config, AdjustToMax);
     
@@ -460,11 +1295,28 @@ int main() {
     dump_p1_strategy(*hole_hand_strategies);
   }
     
-  printf("\n\n========================================== AdjustConverge ==============================================\n\n");
+  printf("\n\n========================================== %s ==============================================\n\n", adjust == AdjustCfrPlus ? "AdjustCfrPlus" : adjust == AdjustDcfr ? "AdjustDcfr" : "AdjustConverge");
 
-  const ConvergeConfig config = { dealer, N_ROUNDS, N_DEALS, N_DEALS_INC, leeway, leeway_inc, min_strategy, clamp_policy, clamp_to_min_n_rounds, dump_n_rounds };
+  const ConvergeConfig config = {
+    .dealer = dealer, .n_rounds = N_ROUNDS, .n_deals = N_DEALS, .n_deals_inc = N_DEALS_INC, .leeway = leeway, .leeway_inc = leeway_inc,
+    .min_strategy = min_strategy, .clamp_policy = clamp_policy, .clamp_to_min_n_rounds = clamp_to_min_n_rounds, .dump_n_rounds = dump_n_rounds,
+    .n_threads = n_threads, .exact_equity = exact_equity, .target_exploitability = target_exploitability,
+    .prune_p = prune_p, .prune_revisit_n_rounds = prune_revisit_n_rounds, .flat_storage = flat_storage,
+    .start_round = start_round, .checkpoint_n_rounds = checkpoint_n_rounds, .checkpoint_path = checkpoint_path,
+    .adaptive_deals = adaptive_deals, .external_sampling = external_sampling, .metrics_file = metrics_file };
 
-  converge_heads_up_preflop_strategies(*hole_hand_strategies, config, AdjustConverge);
+  converge_heads_up_preflop_strategies(*hole_hand_strategies, config, adjust);
+
+  if(metrics_file != nullptr) {
+    fclose(metrics_file);
+  }
+
+  if(is_cfr_adjust(adjust)) {
+    printf("\n\nAverage strategies:\n\n");
+    dump_p0_strategy(*hole_hand_strategies);
+    printf("\n\n");
+    dump_p1_strategy(*hole_hand_strategies);
+  }
 
   if(false) {
     //
@@ -483,7 +1335,9 @@ int main() {
     printf("==============                                                             ===============\n");
     printf("==========================================================================================\n\n\n");
     
-    const ConvergeConfig config1 = { dealer, /*n_rounds*/1, N_DEALS_FINAL, /*n_deals_inc*/0, /*leeway*/1.0, /*leeway_inc*/0.0, min_strategy, ClampToMin, /*clamp_to_min_n_rounds*/0, /*dump_n_rounds*/0 };
+    const ConvergeConfig config1 = {
+      .dealer = dealer, .n_rounds = 1, .n_deals = N_DEALS_FINAL, .leeway = 1.0,
+      .min_strategy = min_strategy, .clamp_policy = ClampToMin, .dump_n_rounds = 0, .n_threads = n_threads, .exact_equity = exact_equity };
     
     converge_heads_up_preflop_strategies(*hole_hand_strategies, config1, AdjustConverge);
     
@@ -494,7 +1348,9 @@ int main() {
     printf("==============                                                             ===============\n");
     printf("==========================================================================================\n\n\n");
     
-    const ConvergeConfig config2 = { dealer, /*n_rounds*/1, N_DEALS_FINAL, /*n_deals_inc*/0, /*leeway*/1.0, /*leeway_inc*/0.0, min_strategy, ClampToZero, /*clamp_to_min_n_rounds*/0, /*dump_n_rounds*/1 };
+    const ConvergeConfig config2 = {
+      .dealer = dealer, .n_rounds = 1, .n_deals = N_DEALS_FINAL, .leeway = 1.0,
+      .min_strategy = min_strategy, .clamp_policy = ClampToZero, .dump_n_rounds = 1, .n_threads = n_threads, .exact_equity = exact_equity };
     
     converge_heads_up_preflop_strategies(*hole_hand_strategies, config2, AdjustConverge);
     
@@ -509,6 +1365,14 @@ int main() {
     printf("\n\n");
     dump_p1_strategy(*hole_hand_strategies);
   }
+
+  // Persist the solved strategies for fast lookup - see gto-lookup.hpp
+  const std::string strategy_table_path = TableFile::table_path(limit_strategy_table_name<LimitRootTwoHandStrategy>().c_str());
+  if(write_limit_strategy_table(strategy_table_path, *hole_hand_strategies)) {
+    printf("\n\nWrote strategy table %s\n", strategy_table_path.c_str());
+  } else {
+    fprintf(stderr, "Failed to write strategy table %s\n", strategy_table_path.c_str());
+  }
   
   delete hole_hand_strategies;
 
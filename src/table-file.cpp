@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "table-file.hpp"
+
+using namespace Poker;
+
+std::string Poker::TableFile::table_dir() {
+  const char* dir = std::getenv("POKERMON_TABLE_DIR");
+  return (dir != nullptr && dir[0] != '\0') ? std::string(dir) : std::string(".");
+}
+
+std::string Poker::TableFile::table_path(const char* table_name) {
+  return table_dir() + "/" + table_name + ".tbl";
+}
+
+bool Poker::TableFile::write_table(const std::string& path, u32 table_id, u32 table_version, u32 elem_size, u64 n_elems, const void* data) {
+  TableFileHeaderT header = {};
+  std::memcpy(header.magic, TABLE_FILE_MAGIC, sizeof(header.magic));
+  header.format_version = TABLE_FILE_FORMAT_VERSION;
+  header.table_id = table_id;
+  header.table_version = table_version;
+  header.elem_size = elem_size;
+  header.n_elems = n_elems;
+
+  // Unique temp name so that concurrent generators don't trample each other - last rename wins
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+
+  FILE* f = std::fopen(tmp_path.c_str(), "wb");
+  if (f == nullptr) {
+    return false;
+  }
+
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+    && std::fwrite(data, elem_size, n_elems, f) == n_elems;
+  ok = (std::fclose(f) == 0) && ok;
+
+  if (ok) {
+    ok = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+  }
+  if (!ok) {
+    std::remove(tmp_path.c_str());
+  }
+
+  return ok;
+}
+
+const void* Poker::TableFile::map_table(const std::string& path, u32 table_id, u32 table_version, u32 elem_size, u64 n_elems) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  const std::size_t size = sizeof(TableFileHeaderT) + (std::size_t)elem_size * n_elems;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (std::size_t)st.st_size != size) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping holds its own reference to the file
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const TableFileHeaderT* header = (const TableFileHeaderT*)addr;
+  if (std::memcmp(header->magic, TABLE_FILE_MAGIC, sizeof(header->magic)) != 0
+      || header->format_version != TABLE_FILE_FORMAT_VERSION
+      || header->table_id != table_id
+      || header->table_version != table_version
+      || header->elem_size != elem_size
+      || header->n_elems != n_elems) {
+    munmap(addr, size);
+    return nullptr;
+  }
+
+  return (const char*)addr + sizeof(TableFileHeaderT);
+}
+
+void Poker::TableFile::unmap_table(const void* data, u32 elem_size, u64 n_elems) {
+  const std::size_t size = sizeof(TableFileHeaderT) + (std::size_t)elem_size * n_elems;
+  munmap((void*)((const char*)data - sizeof(TableFileHeaderT)), size);
+}
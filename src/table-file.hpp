@@ -0,0 +1,90 @@
+#ifndef TABLE_FILE_HPP
+#define TABLE_FILE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "types.hpp"
+
+namespace Poker {
+  namespace TableFile {
+
+    // Table files are a fixed header followed by the raw table elements in host byte order.
+    // They are generated once and then mmapped read-only by every process, so the pages are
+    //   shared through the page cache and startup costs nothing.
+    const char TABLE_FILE_MAGIC[8] = { 'P', 'K', 'M', 'N', 'T', 'B', 'L', '\0' };
+
+    // Bump when the header layout changes
+    const u32 TABLE_FILE_FORMAT_VERSION = 1;
+
+    // Known tables
+    enum TableIdT {
+      OmahaHoleNormalFromIndexTable = 1,
+      HoldemPreflopEquityTable = 2,
+      GtoStrategyCheckpointTable = 3,
+      LimitStrategyTable = 4,
+    };
+
+    struct TableFileHeaderT {
+      char magic[8];
+      u32 format_version;
+      u32 table_id;
+      // Bump when the table contents change for a given table id
+      u32 table_version;
+      u32 elem_size;
+      u64 n_elems;
+      // Keeps the table data 8-byte aligned after the header
+      u64 reserved;
+    };
+
+    static_assert(sizeof(TableFileHeaderT) == 40);
+
+    // Directory for table files - $POKERMON_TABLE_DIR, else the current directory
+    extern std::string table_dir();
+
+    // @return full path of the table file for the given table name
+    extern std::string table_path(const char* table_name);
+
+    // Write the table to path, atomically via rename of a temporary file.
+    // @return true on success
+    extern bool write_table(const std::string& path, u32 table_id, u32 table_version, u32 elem_size, u64 n_elems, const void* data);
+
+    // Map the table file read-only.
+    // @return pointer to the table data, or nullptr if the file is missing or its header doesn't match
+    extern const void* map_table(const std::string& path, u32 table_id, u32 table_version, u32 elem_size, u64 n_elems);
+
+    // Unmap table data returned by map_table()
+    extern void unmap_table(const void* data, u32 elem_size, u64 n_elems);
+
+    // Map the table file if it is present and valid, else generate the table, persist it for
+    //   subsequent processes and map that. If the table can't be persisted (read-only directory)
+    //   the generated table is kept in memory.
+    // The table is never unmapped/freed.
+    template <typename T>
+    const T* load_or_generate_table(const char* table_name, u32 table_id, u32 table_version, std::size_t n_elems, const std::function<void(T*)>& generate) {
+      const std::string path = table_path(table_name);
+
+      const void* data = map_table(path, table_id, table_version, sizeof(T), n_elems);
+      if (data != nullptr) {
+	return (const T*)data;
+      }
+
+      T* table = new T[n_elems]();
+      generate(table);
+
+      if (write_table(path, table_id, table_version, sizeof(T), n_elems, table)) {
+	data = map_table(path, table_id, table_version, sizeof(T), n_elems);
+	if (data != nullptr) {
+	  delete[] table;
+	  return (const T*)data;
+	}
+      }
+
+      return table;
+    }
+
+  } // namespace TableFile
+} // namespace Poker
+
+#endif //ndef TABLE_FILE_HPP